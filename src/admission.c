@@ -0,0 +1,254 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "admission.h"
+
+
+struct admitted {
+    const char *name;
+    unsigned long long period_ms;
+    unsigned long long deadline_ms;
+    unsigned long long wcet_ms;
+    unsigned long long blocking_ms;
+    unsigned int wcet_steps;
+    int priority;
+    int used;
+};
+
+struct admission {
+    pthread_mutex_t lock;
+    unsigned long long step_ms;
+    int capacity;
+    struct admitted *tasks;
+};
+
+/*
+ * Worst-case response time of task i on one processor, by the classic
+ * iteration R = C_i + B_i + sum over tasks j of priority >= p_i of ceil(R / T_j) * C_j.
+ * Stops as soon as R exceeds the deadline: the task is then not schedulable
+ * and the value returned is that first R past the deadline. With deadlines
+ * no longer than the periods, only the first job after the critical instant
+ * needs to be checked.
+ */
+static unsigned long long response_time(const struct admission *adm, int i) {
+    const struct admitted *task = &adm->tasks[i];
+    unsigned long long r = task->wcet_ms + task->blocking_ms;
+    while (1) {
+        unsigned long long next = task->wcet_ms + task->blocking_ms;
+        for (int j = 0; j < adm->capacity; ++j) {
+            const struct admitted *other = &adm->tasks[j];
+            if (j == i || !other->used || other->priority < task->priority) {
+                continue;
+            }
+            next += (r + other->period_ms - 1) / other->period_ms * other->wcet_ms;
+        }
+        if (next == r || next > task->deadline_ms) {
+            return next;
+        }
+        r = next;
+    }
+}
+
+/*
+ * Schedulability test of the tasks in use, the candidate included. The
+ * candidate is checked first so that a rejection blames it when it cannot
+ * meet its own deadline.
+ */
+static enum admission_reason schedulable(struct admission *adm, int candidate,
+                                         admission_verdict_t *verdict) {
+    int n = 0;
+    int blocking = 0;
+    int constrained = 0;
+    // Utilization as a fraction of the hyperperiod would overflow quickly, a double is precise enough
+    double u = 0.0;
+    for (int i = 0; i < adm->capacity; ++i) {
+        if (adm->tasks[i].used) {
+            u += (double) adm->tasks[i].wcet_ms / adm->tasks[i].period_ms;
+            blocking |= adm->tasks[i].blocking_ms != 0;
+            constrained |= adm->tasks[i].deadline_ms < adm->tasks[i].period_ms;
+            ++n;
+        }
+    }
+    verdict->utilization = u;
+    verdict->bound = n * (pow(2.0, 1.0 / n) - 1.0);
+    verdict->victim = -1;
+    verdict->response_ms = 0;
+    if (u > 1.0 + 1e-9) {
+        return ADMISSION_UTILIZATION;
+    }
+    // The bound only holds for implicit deadlines and without blocking
+    if (u <= verdict->bound && !blocking && !constrained) {
+        return ADMISSION_ACCEPTED;
+    }
+    for (int k = -1; k < adm->capacity; ++k) {
+        int i = k < 0 ? candidate : k;
+        if ((k >= 0 && i == candidate) || !adm->tasks[i].used) {
+            continue;
+        }
+        unsigned long long r = response_time(adm, i);
+        if (r > adm->tasks[i].deadline_ms) {
+            verdict->victim = i;
+            verdict->response_ms = r;
+            return ADMISSION_RESPONSE_TIME;
+        }
+    }
+    return ADMISSION_ACCEPTED;
+}
+
+error_t init_admission(admission_t **adm, int capacity, unsigned long long step_ms) {
+    if (!adm) {
+        return NULL_PTR;
+    }
+    *adm = NULL;
+    if (capacity < 1 || !step_ms) {
+        return INVALID_ARGUMENT;
+    }
+    struct admission *a = calloc(1, sizeof(struct admission));
+    if (!a) {
+        return MALLOC;
+    }
+    a->tasks = calloc(capacity, sizeof(struct admitted));
+    if (!a->tasks) {
+        free(a);
+        return MALLOC;
+    }
+    if (pthread_mutex_init(&a->lock, NULL)) {
+        free(a->tasks);
+        free(a);
+        return MUTEX;
+    }
+    a->capacity = capacity;
+    a->step_ms = step_ms;
+    *adm = a;
+    return OK;
+}
+
+error_t free_admission(admission_t *adm) {
+    if (!adm) {
+        return NULL_PTR;
+    }
+    error_t res = OK;
+    if (pthread_mutex_destroy(&adm->lock)) {
+        res = MUTEX;
+    }
+    free(adm->tasks);
+    free(adm);
+    return res;
+}
+
+error_t admission_register(admission_t *adm, const char *name, unsigned long long period_ms,
+                           unsigned long long deadline_ms, unsigned int wcet_steps, int priority,
+                           int *id, admission_verdict_t *verdict) {
+    if (!adm || !name || !id) {
+        return NULL_PTR;
+    }
+    admission_verdict_t local;
+    if (!verdict) {
+        verdict = &local;
+    }
+    *verdict = (admission_verdict_t) {.reason = ADMISSION_INVALID_TASK, .victim = -1};
+    unsigned long long wcet_ms = wcet_steps * adm->step_ms;
+    if (!deadline_ms) {
+        deadline_ms = period_ms;
+    }
+    if (!period_ms || !wcet_steps || deadline_ms > period_ms || wcet_ms > deadline_ms) {
+        return REJECTED;
+    }
+    if (pthread_mutex_lock(&adm->lock)) {
+        return MUTEX;
+    }
+    int slot;
+    for (slot = 0; slot < adm->capacity && adm->tasks[slot].used; ++slot) {
+    }
+    if (slot == adm->capacity) {
+        verdict->reason = ADMISSION_FULL;
+    } else {
+        adm->tasks[slot] = (struct admitted) {name, period_ms, deadline_ms, wcet_ms, 0, wcet_steps, priority, 1};
+        verdict->reason = schedulable(adm, slot, verdict);
+        if (verdict->reason == ADMISSION_ACCEPTED) {
+            *id = slot;
+        } else {
+            adm->tasks[slot].used = 0;
+        }
+    }
+    if (pthread_mutex_unlock(&adm->lock)) {
+        return MUTEX;
+    }
+    return verdict->reason == ADMISSION_ACCEPTED ? OK : REJECTED;
+}
+
+error_t admission_unregister(admission_t *adm, int id) {
+    if (!adm) {
+        return NULL_PTR;
+    }
+    if (pthread_mutex_lock(&adm->lock)) {
+        return MUTEX;
+    }
+    error_t res = OK;
+    if (id < 0 || id >= adm->capacity || !adm->tasks[id].used) {
+        res = INVALID_ARGUMENT;
+    } else {
+        adm->tasks[id].used = 0;
+    }
+    if (pthread_mutex_unlock(&adm->lock)) {
+        return MUTEX;
+    }
+    return res;
+}
+
+error_t admission_set_blocking(admission_t *adm, int id, unsigned long long blocking_ms,
+                               admission_verdict_t *verdict) {
+    if (!adm) {
+        return NULL_PTR;
+    }
+    admission_verdict_t local;
+    if (!verdict) {
+        verdict = &local;
+    }
+    if (pthread_mutex_lock(&adm->lock)) {
+        return MUTEX;
+    }
+    error_t res = OK;
+    if (id < 0 || id >= adm->capacity || !adm->tasks[id].used) {
+        res = INVALID_ARGUMENT;
+    } else {
+        adm->tasks[id].blocking_ms = blocking_ms;
+        verdict->reason = schedulable(adm, id, verdict);
+    }
+    if (pthread_mutex_unlock(&adm->lock)) {
+        return MUTEX;
+    }
+    return res;
+}
+
+const char *admission_reason_str(enum admission_reason reason) {
+    switch (reason) {
+        case ADMISSION_ACCEPTED: return "accepted";
+        case ADMISSION_INVALID_TASK: return "invalid task (period or WCET of 0, WCET longer than the deadline or deadline longer than the period)";
+        case ADMISSION_FULL: return "no free slot in the admission controller";
+        case ADMISSION_UTILIZATION: return "total utilization would exceed 1";
+        case ADMISSION_RESPONSE_TIME: return "a task would miss its deadline (response time > deadline)";
+        default: return "unknown";
+    }
+}
+
+void admission_report(admission_t *adm, FILE *out) {
+    if (!adm || !out || pthread_mutex_lock(&adm->lock)) {
+        return;
+    }
+    double u = 0.0;
+    fprintf(out, "%-14s %10s %11s %6s %9s %9s %8s %7s %10s\n", "task", "period ms", "deadline ms",
+            "steps", "wcet ms", "block ms", "priority", "util", "resp ms");
+    for (int i = 0; i < adm->capacity; ++i) {
+        const struct admitted *t = &adm->tasks[i];
+        if (!t->used) {
+            continue;
+        }
+        u += (double) t->wcet_ms / t->period_ms;
+        fprintf(out, "%-14s %10llu %11llu %6u %9llu %9llu %8d %7.3f %10llu\n", t->name, t->period_ms,
+                t->deadline_ms, t->wcet_steps, t->wcet_ms, t->blocking_ms, t->priority, (double) t->wcet_ms / t->period_ms, response_time(adm, i));
+    }
+    fprintf(out, "%-14s %67.3f\n", "total", u);
+    pthread_mutex_unlock(&adm->lock);
+}
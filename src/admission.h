@@ -0,0 +1,159 @@
+/**
+ * @file admission.h
+ * @brief Runtime admission control of periodic patrol tasks.
+ *
+ * Tasks are registered with a period, a relative deadline, a WCET in sensor
+ * steps and a fixed priority, and share one processor, as in the scheduling
+ * analysis of the README. Deadlines are constrained (deadline <= period): a
+ * patrol must end before the attack it was released for, well before its next
+ * period. Each registration is accepted only if the task set stays
+ * schedulable: the total utilization must not exceed 1, and unless every
+ * deadline is implicit (deadline = period) and the utilization is under the
+ * Liu & Layland bound, the worst-case response time of every task, computed
+ * by response-time analysis, must not exceed its deadline. A rejected task leaves
+ * the set unchanged and the verdict tells why. The blocking term of each
+ * task, i.e., the longest time it can wait for a mutex held by a lower
+ * priority task, can be set from measurements (see get_lock_stats).
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+
+#include "chickens.h"
+
+
+// --- Enumerations and Structures ---
+
+/**
+ * @enum admission_reason
+ * @brief Outcome of a registration.
+ */
+enum admission_reason {
+    /// The task was admitted
+    ADMISSION_ACCEPTED = 0,
+    /// The period or the WCET is 0, the WCET is longer than the deadline or the deadline longer than the period
+    ADMISSION_INVALID_TASK = 1,
+    /// Every slot of the admission controller is taken
+    ADMISSION_FULL = 2,
+    /// The total utilization would exceed 1
+    ADMISSION_UTILIZATION = 3,
+    /// A task (the new one or a lower-priority one) would miss its deadline
+    ADMISSION_RESPONSE_TIME = 4,
+};
+
+/**
+ * @struct admission_verdict
+ * @brief Details of the schedulability test of a registration.
+ */
+struct admission_verdict {
+    /// Outcome of the registration
+    enum admission_reason reason;
+    /// Total utilization of the task set including the new task
+    double utilization;
+    /// Liu & Layland bound for that number of tasks
+    double bound;
+    /// Task whose response time exceeds its deadline (ADMISSION_RESPONSE_TIME), -1 otherwise
+    int victim;
+    /// Worst-case response time of the victim (ms), 0 if unbounded or no victim
+    unsigned long long response_ms;
+};
+
+/**
+ * @typedef admission_verdict_t
+ * @brief Typedef for the verdict of a registration.
+ * @see struct admission_verdict
+ */
+typedef struct admission_verdict admission_verdict_t;
+
+/**
+ * @typedef admission_t
+ * @brief Set of admitted tasks (Opaque structure).
+ */
+typedef struct admission admission_t;
+
+
+// --- Functions ---
+
+/**
+ * @brief Initializes an empty admission controller.
+ *
+ * Must be freed with free_admission.
+ *
+ * @param adm Pointer to a pointer of type admission_t, which will be set.
+ * @param capacity Maximum number of tasks registered at once.
+ * @param step_ms Duration of one sensor step (ms), e.g., STEP_TIME.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t init_admission(admission_t **adm, int capacity, unsigned long long step_ms);
+
+/**
+ * @brief Frees the admission controller.
+ *
+ * @param adm Pointer to the admission controller.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t free_admission(admission_t *adm);
+
+/**
+ * @brief Registers a periodic task if the task set stays schedulable.
+ *
+ * Thread-safe. A higher priority value means a more urgent task; tasks of
+ * equal priority are assumed to delay each other.
+ *
+ * @param adm Pointer to the admission controller.
+ * @param name Name of the task in the report, must outlive its registration.
+ * @param period_ms Period of the task (ms).
+ * @param deadline_ms Deadline of each period, relative to its release (ms),
+ * at most period_ms; 0 for an implicit deadline equal to the period.
+ * @param wcet_steps Worst-case execution time of one period, in sensor steps.
+ * @param priority Fixed priority of the task.
+ * @param id Pointer to the identifier of the task, which will be set if admitted.
+ * @param verdict Pointer to the details of the test (can be NULL).
+ * @return error_t Returns OK if admitted, REJECTED if the test failed (see verdict), or an error code.
+ */
+error_t admission_register(admission_t *adm, const char *name, unsigned long long period_ms,
+                           unsigned long long deadline_ms, unsigned int wcet_steps, int priority,
+                           int *id, admission_verdict_t *verdict);
+
+/**
+ * @brief Unregisters a task, releasing its share of the processor.
+ *
+ * @param adm Pointer to the admission controller.
+ * @param id Identifier given by admission_register.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t admission_unregister(admission_t *adm, int id);
+
+/**
+ * @brief Sets the blocking term B of a task and tests the task set again.
+ *
+ * The term is a fact about the system, so it is kept even if the task set is
+ * no longer schedulable with it; the verdict tells whether it still is. Once
+ * a task has a blocking term, response-time analysis is always performed.
+ *
+ * @param adm Pointer to the admission controller.
+ * @param id Identifier given by admission_register.
+ * @param blocking_ms Longest blocking of one period of the task (ms).
+ * @param verdict Pointer to the result of the test (can be NULL).
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t admission_set_blocking(admission_t *adm, int id, unsigned long long blocking_ms,
+                               admission_verdict_t *verdict);
+
+/**
+ * @brief Gives a human-readable description of a reason.
+ *
+ * @param reason The reason.
+ * @return const char* A static string.
+ */
+const char *admission_reason_str(enum admission_reason reason);
+
+/**
+ * @brief Prints the admitted tasks with their utilization and response time.
+ *
+ * @param adm Pointer to the admission controller.
+ * @param out Stream to print to.
+ */
+void admission_report(admission_t *adm, FILE *out);
@@ -0,0 +1,169 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "farm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Banc d'essai de la détection par lots : remplit une ferme de poulaillers
+// avec des côtés aléatoires, puis mesure le temps d'un balayage des quatre
+// côtés pour chaque implémentation, en vérifiant qu'elles donnent toutes le
+// même masque que la version scalaire.
+// Avec -l, les poulaillers sont chassés pour de vrai (une arène, menaces
+// accélérées) et attachés à la ferme par farm_attach : chaque balayage est
+// comparé aux côtés des menaces lus par snapshot.
+//
+// Usage : bench-farm [poulaillers] [balayages]
+//         bench-farm -l [poulaillers] [secondes]
+
+// Accélération des menaces en mode -l : le renard change de côté toutes les 40 ms
+#define FACTEUR_VIVANT 100
+
+// Vérifie les côtés reflétés dans la ferme contre ceux des menaces. Un poulailler
+// n'est vérifié que si sa version n'a pas changé pendant le balayage.
+int verifier_vivant(int nb, int secondes) {
+    coop_t *coop = NULL;
+    farm_t *farm = NULL;
+    sensors_t **sensors = calloc(nb, sizeof(sensors_t *));
+    snapshot_t *avant = calloc(nb, sizeof(snapshot_t));
+    if (!sensors || !avant || init_farm(&farm, nb) != OK
+        || init_coop_arena(&coop, sensors, nb, 1) != OK) {
+        fprintf(stderr, "Erreur lors de l'initialisation des poulaillers\n");
+        free_farm(farm);
+        free(sensors);
+        free(avant);
+        return 1;
+    }
+    set_coop_mode(coop, COOP_QUIET | COOP_NO_EXIT);
+    int words = farm_mask_words(farm);
+    uint64_t *mask = calloc(4 * words, sizeof(uint64_t));
+    int attaches = 0;
+    while (mask && attaches < nb && set_time_scale(sensors[attaches], FACTEUR_VIVANT) == OK
+           && farm_attach(farm, attaches, sensors[attaches]) == OK) {
+        ++attaches;
+    }
+    unsigned long long balayages = 0, verifies = 0, ignores = 0, menaces = 0, erreurs = 0;
+    if (attaches == nb) {
+        for (int i = 0; i < nb; ++i) {
+            start_hunt(sensors[i], coop);
+        }
+        struct timespec pause = {0, 1000000L};
+        unsigned long long fin = now_ns() + secondes * 1000000000ULL;
+        while (now_ns() < fin) {
+            for (int i = 0; i < nb; ++i) {
+                snapshot(sensors[i], &avant[i]);
+            }
+            for (side_t side = NORTH; side <= ABOVE; ++side) {
+                farm_detect(farm, side, mask + (side - 1) * words, NULL);
+            }
+            for (int i = 0; i < nb; ++i) {
+                snapshot_t apres;
+                snapshot(sensors[i], &apres);
+                if (apres.version != avant[i].version) {
+                    ++ignores;
+                    continue;
+                }
+                ++verifies;
+                for (side_t side = NORTH; side <= ABOVE; ++side) {
+                    int menace = side == ABOVE ? EAGLE_THREAT : FOX_THREAT;
+                    int attendu = avant[i].threat_side[menace] == side;
+                    int trouve = (mask[(side - 1) * words + i / 64] >> (i % 64)) & 1;
+                    menaces += attendu;
+                    erreurs += attendu != trouve;
+                }
+            }
+            ++balayages;
+            // Laisser tourner les timers des menaces (un seul cœur suffit)
+            nanosleep(&pause, NULL);
+        }
+        for (int i = 0; i < nb; ++i) {
+            stop_hunt(sensors[i]);
+        }
+        printf("%d poulaillers chassés (facteur %d), %llu balayages : %llu vérifiés, %llu ignorés "
+               "(état changé pendant le balayage), %llu menaces vues, %llu erreurs\n",
+               nb, FACTEUR_VIVANT, balayages, verifies, ignores, menaces, erreurs);
+    } else {
+        fprintf(stderr, "Erreur lors de l'attache des capteurs à la ferme\n");
+    }
+    for (int i = 0; i < attaches; ++i) {
+        farm_detach(farm, i, sensors[i]);
+    }
+    free_coop_arena(coop);
+    free_farm(farm);
+    free(mask);
+    free(sensors);
+    free(avant);
+    // Sans aucune menace vue, le chemin des côtés reflétés n'aurait rien vérifié
+    return attaches == nb && !erreurs && menaces ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && !strcmp(argv[1], "-l")) {
+        int nb = argc > 2 ? atoi(argv[2]) : 64;
+        int secondes = argc > 3 ? atoi(argv[3]) : 5;
+        if (nb <= 0 || secondes <= 0) {
+            fprintf(stderr, "Usage : %s -l [poulaillers] [secondes]\n", argv[0]);
+            return 1;
+        }
+        return verifier_vivant(nb, secondes);
+    }
+    int nb = argc > 1 ? atoi(argv[1]) : 10000;
+    int balayages = argc > 2 ? atoi(argv[2]) : 10000;
+    if (nb <= 0 || balayages <= 0) {
+        fprintf(stderr, "Usage : %s [poulaillers] [balayages]\n", argv[0]);
+        fprintf(stderr, "        %s -l [poulaillers] [secondes]\n", argv[0]);
+        return 1;
+    }
+    farm_t *farm;
+    if (init_farm(&farm, nb) != OK) {
+        fprintf(stderr, "Erreur lors de l'initialisation de la ferme\n");
+        return 1;
+    }
+    srand((unsigned)time(NULL));
+    for (int i = 0; i < nb; ++i) {
+        farm_set(farm, i, FOX_THREAT, rand() % 4);          // AWAY, NORTH, SOUTH ou EAST
+        farm_set(farm, i, EAGLE_THREAT, rand() % 2 ? ABOVE : AWAY);
+    }
+
+    int words = farm_mask_words(farm);
+    uint64_t *reference = calloc(4 * words, sizeof(uint64_t));
+    uint64_t *mask = calloc(4 * words, sizeof(uint64_t));
+    if (!reference || !mask) {
+        fprintf(stderr, "Mémoire insuffisante\n");
+        return 1;
+    }
+    farm_set_impl(farm, FARM_SCALAR);
+    for (side_t side = NORTH; side <= ABOVE; ++side) {
+        farm_detect(farm, side, reference + (side - 1) * words, NULL);
+    }
+
+    const char *noms[] = {"auto", "scalar", "sse2", "avx2"};
+    printf("%d poulaillers, %d balayages des 4 côtés\n", nb, balayages);
+    int erreurs = 0;
+    for (int impl = FARM_SCALAR; impl <= FARM_AVX2; ++impl) {
+        if (farm_set_impl(farm, impl) != OK) {
+            printf("%-7s non supporté par ce CPU\n", noms[impl]);
+            continue;
+        }
+        int trouves = 0;
+        unsigned long long debut = now_ns();
+        for (int b = 0; b < balayages; ++b) {
+            for (side_t side = NORTH; side <= ABOVE; ++side) {
+                int count;
+                farm_detect(farm, side, mask + (side - 1) * words, &count);
+                trouves += count;
+            }
+        }
+        unsigned long long duree = now_ns() - debut;
+        int identique = !memcmp(mask, reference, 4 * words * sizeof(uint64_t));
+        erreurs += !identique;
+        printf("%-7s %10.2f us/balayage  %8d alarmes/balayage  %s\n", noms[impl],
+               duree / 1e3 / balayages, trouves / balayages, identique ? "ok" : "MASQUE DIFFÉRENT");
+    }
+
+    free(reference);
+    free(mask);
+    free_farm(farm);
+    return erreurs ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "chickens.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// Banc d'essai de passage à l'échelle : balaye le nombre de poulaillers, de
+// threads de patrouille et de menaces par poulailler, et mesure pour chaque
+// configuration le débit des sense réussis (les appels en erreur sont comptés
+// à part), le taux de vols, l'attente sur les mutex (mesurée par
+// get_lock_stats) et l'utilisation CPU. Une ligne CSV par configuration, prête
+// à être tracée (une courbe par nombre de menaces par exemple).
+//
+// Usage : bench-scaling [-c 1,2,4,8] [-p 1,2,4] [-t 2,4] [-d secondes] [-s facteur] [-a]
+//   -c  nombres de poulaillers
+//   -p  nombres de threads de patrouille
+//   -t  nombres de menaces par poulailler (multiple de 2 : un renard et un aigle par capteur)
+//   -d  durée de chaque mesure en secondes
+//   -s  facteur d'accélération du temps (set_time_scale)
+//   -a  construit chaque poulailler dans une arène alignée (init_coop_arena)
+//       pour comparer avec l'allocation séparée (faux partage)
+
+#define MAX_VALUES 16
+
+// Un poulailler et tous les capteurs (donc toutes les menaces) qui le chassent
+typedef struct {
+    coop_t *coop;
+    sensors_t **sensors;
+} cell_t;
+
+typedef struct {
+    cell_t *cells;
+    int nb_cells;
+    int sensors_per_cell;
+    int first;
+    volatile int *stop;
+    /// Côtés effectivement scannés (les appels en erreur ne comptent pas)
+    unsigned long long ops;
+    unsigned long long errors;
+} patrol_t;
+
+int use_arena = 0;
+
+unsigned long long cpu_ns(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL
+        + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+int parse_list(char *arg, int *values) {
+    int n = 0;
+    for (char *tok = strtok(arg, ","); tok && n < MAX_VALUES; tok = strtok(NULL, ",")) {
+        values[n] = atoi(tok);
+        if (values[n] > 0) {
+            n++;
+        }
+    }
+    return n;
+}
+
+// Patrouille en boucle fermée : chaque thread parcourt tous les poulaillers en
+// partant d'un décalage différent, pour que les threads se croisent sur les
+// mêmes têtes lorsqu'il y a peu de poulaillers.
+void* patrol(void* arg) {
+    patrol_t *p = arg;
+    const side_t fox_sides[] = {NORTH, SOUTH, EAST};
+    sense_t results[3];
+    for (int k = p->first; !*p->stop; ++k) {
+        cell_t *cell = &p->cells[k % p->nb_cells];
+        for (int s = 0; s < p->sensors_per_cell && !*p->stop; ++s) {
+            sensors_t *sensors = cell->sensors[s];
+            if (sense_multi(sensors, fox_sides, 3, results) == OK) {
+                p->ops += 3;
+                for (int i = 0; i < 3; ++i) {
+                    if (results[i] == DETECTED) {
+                        sound_alarm(sensors, fox_sides[i]);
+                    }
+                }
+            } else {
+                p->errors++;
+            }
+            error_t err = OK;
+            sense_t above = sense(sensors, ABOVE, &err);
+            if (err != OK) {
+                p->errors++;
+            } else {
+                p->ops++;
+                if (above == DETECTED) {
+                    sound_alarm(sensors, ABOVE);
+                }
+            }
+        }
+        add_chicken(cell->coop);
+    }
+    return NULL;
+}
+
+// Mesure une configuration et écrit sa ligne CSV. Retourne 0 si tout s'est bien passé.
+int run(int coops, int patrols, int threats, int seconds, unsigned int scale) {
+    int per_cell = threats / 2;
+    cell_t *cells = calloc(coops, sizeof(cell_t));
+    patrol_t *p = calloc(patrols, sizeof(patrol_t));
+    pthread_t *threads = calloc(patrols, sizeof(pthread_t));
+    if (!cells || !p || !threads) {
+        free(cells);
+        free(p);
+        free(threads);
+        return 1;
+    }
+    int ok = 1;
+    for (int i = 0; i < coops && ok; ++i) {
+        cells[i].sensors = calloc(per_cell, sizeof(sensors_t*));
+        if (!cells[i].sensors) {
+            ok = 0;
+        } else if (use_arena) {
+            ok = init_coop_arena(&cells[i].coop, cells[i].sensors, per_cell, MAX_SENSOR_HEADS) == OK;
+        } else {
+            ok = init_coop(&cells[i].coop) == OK;
+            for (int s = 0; s < per_cell && ok; ++s) {
+                ok = init_sensors_heads(&cells[i].sensors[s], MAX_SENSOR_HEADS) == OK;
+            }
+        }
+        ok = ok && set_coop_mode(cells[i].coop, COOP_QUIET | COOP_NO_EXIT) == OK;
+        for (int s = 0; s < per_cell && ok; ++s) {
+            ok = set_time_scale(cells[i].sensors[s], scale) == OK;
+        }
+    }
+
+    volatile int stop = 0;
+    int started = 0;
+    unsigned long long stolen = 0, wall = 0, cpu = 0;
+    // Attentes réelles sur les mutex, comptées par timed_lock dans chickens.c
+    lock_stats_t locks = {0};
+    if (ok) {
+        for (int i = 0; i < coops; ++i) {
+            for (int s = 0; s < per_cell; ++s) {
+                start_hunt(cells[i].sensors[s], cells[i].coop);
+            }
+        }
+        unsigned long long cpu_begin = cpu_ns();
+        unsigned long long wall_begin = now_ns();
+        for (started = 0; started < patrols; ++started) {
+            p[started] = (patrol_t) { cells, coops, per_cell, started * coops / patrols, &stop, 0, 0 };
+            if (pthread_create(&threads[started], NULL, patrol, &p[started])) {
+                ok = 0;
+                break;
+            }
+        }
+        sleep(seconds);
+        stop = 1;
+        for (int i = 0; i < started; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+        wall = now_ns() - wall_begin;
+        cpu = cpu_ns() - cpu_begin;
+        for (int i = 0; i < coops; ++i) {
+            unsigned long long coop_stolen = 0;
+            get_stolen(cells[i].coop, &coop_stolen);
+            stolen += coop_stolen;
+            for (int s = 0; s < per_cell; ++s) {
+                stop_hunt(cells[i].sensors[s]);
+            }
+            for (int kind = 0; kind < LOCK_KINDS; ++kind) {
+                for (int s = 0; s < (kind == LOCK_COOP ? 1 : per_cell); ++s) {
+                    lock_stats_t ls;
+                    if (get_lock_stats(cells[i].sensors[s], cells[i].coop, kind, &ls) == OK) {
+                        locks.acquisitions += ls.acquisitions;
+                        locks.contended += ls.contended;
+                        locks.blocked_sum_ns += ls.blocked_sum_ns;
+                    }
+                }
+            }
+        }
+    }
+
+    if (ok) {
+        unsigned long long ops = 0, errors = 0;
+        for (int i = 0; i < patrols; ++i) {
+            ops += p[i].ops;
+            errors += p[i].errors;
+        }
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        printf("%s,%d,%d,%d,%.1f,%.2f,%.1f,%.1f,%.1f,%llu\n", use_arena ? "arena" : "malloc",
+               coops, patrols, threats,
+               ops * 1e9 / wall,
+               stolen * 1e9 / wall,
+               ops ? locks.blocked_sum_ns / 1e3 / ops : 0.0,
+               locks.acquisitions ? 100.0 * locks.contended / locks.acquisitions : 0.0,
+               100.0 * cpu / wall / (cores > 0 ? cores : 1), errors);
+        fflush(stdout);
+    } else {
+        fprintf(stderr, "Configuration %d/%d/%d impossible à initialiser\n", coops, patrols, threats);
+    }
+
+    for (int i = 0; i < coops; ++i) {
+        if (use_arena) {
+            if (cells[i].coop) {
+                free_coop_arena(cells[i].coop);
+            }
+            free(cells[i].sensors);
+            continue;
+        }
+        for (int s = 0; cells[i].sensors && s < per_cell; ++s) {
+            if (cells[i].sensors[s]) {
+                free_sensors(cells[i].sensors[s]);
+            }
+        }
+        free(cells[i].sensors);
+        if (cells[i].coop) {
+            free_coop(cells[i].coop);
+        }
+    }
+    free(cells);
+    free(p);
+    free(threads);
+    return !ok;
+}
+
+int main(int argc, char *argv[]) {
+    int coops[MAX_VALUES] = {1, 2, 4, 8}, nb_coops = 4;
+    int patrols[MAX_VALUES] = {1, 2, 4}, nb_patrols = 3;
+    int threats[MAX_VALUES] = {2, 4}, nb_threats = 2;
+    int seconds = 2;
+    unsigned int scale = 100;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:p:t:d:s:a")) != -1) {
+        switch (opt) {
+            case 'c': nb_coops = parse_list(optarg, coops); break;
+            case 'p': nb_patrols = parse_list(optarg, patrols); break;
+            case 't': nb_threats = parse_list(optarg, threats); break;
+            case 'd': seconds = atoi(optarg); break;
+            case 's': scale = atoi(optarg); break;
+            case 'a': use_arena = 1; break;
+            default:
+                fprintf(stderr, "Usage : %s [-c 1,2,4] [-p 1,2] [-t 2,4] [-d s] [-s facteur] [-a]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (!nb_coops || !nb_patrols || !nb_threats || seconds <= 0 || scale < 1 || scale > EAGLE_TIME) {
+        fprintf(stderr, "Paramètres invalides\n");
+        return 1;
+    }
+    for (int i = 0; i < nb_threats; ++i) {
+        if (threats[i] % 2) {
+            fprintf(stderr, "Le nombre de menaces doit être pair (renard + aigle)\n");
+            return 1;
+        }
+    }
+    srand((unsigned)time(NULL));
+
+    printf("layout,coops,patrols,threats,sense_ops_per_s,steals_per_s,lock_wait_us_per_op,contention_pct,cpu_pct,sense_errors\n");
+    int failures = 0;
+    for (int t = 0; t < nb_threats; ++t) {
+        for (int c = 0; c < nb_coops; ++c) {
+            for (int p = 0; p < nb_patrols; ++p) {
+                failures += run(coops[c], patrols[p], threats[t], seconds, scale);
+            }
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -1,41 +1,176 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <signal.h>
+#include <errno.h>
+#include <sched.h>
 
 #include "chickens.h"
+#include "seqlock.h"
+#include "telemetry.h"
 
 #define NUM_ACTIVE_POS (MAX_ACTIVE_POS - MIN_ACTIVE_POS + 1)
 #define MIN_ACTIVE_POS 1
 #define MAX_ACTIVE_POS 4
 
+#define CACHE_LINE 64
+
 
 typedef struct coop coop_t;
 typedef enum side side_t;
 typedef struct threat threat_t;
 
 
+unsigned long long int now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Every mutex of the system is created by init_mutex with the protocol chosen
+ * by set_lock_protocol, and taken by timed_lock, which accounts the time the
+ * locker was blocked in the lock_stats_t kept next to the mutex. The stats
+ * are only written by the thread that has just taken the mutex.
+ */
+enum lock_protocol lock_protocol = LOCK_PRIO_NONE;
+int lock_ceiling;
+
+error_t set_lock_protocol(enum lock_protocol protocol, int ceiling) {
+    if (protocol < LOCK_PRIO_NONE || protocol > LOCK_PRIO_PROTECT) {
+        return INVALID_ARGUMENT;
+    }
+    if (protocol == LOCK_PRIO_PROTECT && (ceiling < sched_get_priority_min(SCHED_FIFO)
+                                          || ceiling > sched_get_priority_max(SCHED_FIFO))) {
+        return INVALID_ARGUMENT;
+    }
+    lock_protocol = protocol;
+    lock_ceiling = ceiling;
+    return OK;
+}
+
+error_t init_mutex(pthread_mutex_t *mutex, lock_stats_t *stats) {
+    static const int protocols[] = {PTHREAD_PRIO_NONE, PTHREAD_PRIO_INHERIT, PTHREAD_PRIO_PROTECT};
+    pthread_mutexattr_t attr;
+    if (pthread_mutexattr_init(&attr)) {
+        return MUTEX;
+    }
+    error_t res = OK;
+    if (pthread_mutexattr_setprotocol(&attr, protocols[lock_protocol])
+        || (lock_protocol == LOCK_PRIO_PROTECT && pthread_mutexattr_setprioceiling(&attr, lock_ceiling))
+        || pthread_mutex_init(mutex, &attr)) {
+        res = MUTEX;
+    }
+    pthread_mutexattr_destroy(&attr);
+    if (stats) {
+        memset(stats, 0, sizeof(lock_stats_t));
+    }
+    return res;
+}
+
+void account_lock(lock_stats_t *stats, unsigned long long blocked) {
+    int bucket = 0;
+    for (unsigned long long us = blocked / 1000; us && bucket < LOCK_BUCKETS - 1; us >>= 1) {
+        ++bucket;
+    }
+    __atomic_store_n(&stats->acquisitions, stats->acquisitions + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&stats->histogram[bucket], stats->histogram[bucket] + 1, __ATOMIC_RELAXED);
+    if (blocked) {
+        __atomic_store_n(&stats->contended, stats->contended + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->blocked_sum_ns, stats->blocked_sum_ns + blocked, __ATOMIC_RELAXED);
+        if (blocked > stats->blocked_max_ns) {
+            __atomic_store_n(&stats->blocked_max_ns, blocked, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*
+ * Locks the mutex, trying first without blocking so that the clock is only
+ * read when the locker actually waits.
+ */
+int timed_lock(pthread_mutex_t *mutex, lock_stats_t *stats) {
+    int err = pthread_mutex_trylock(mutex);
+    unsigned long long blocked = 0;
+    if (err == EBUSY) {
+        unsigned long long begin = now_ns();
+        if ((err = pthread_mutex_lock(mutex))) {
+            return err;
+        }
+        blocked = now_ns() - begin;
+        if (!blocked) {
+            blocked = 1;
+        }
+    } else if (err) {
+        return err;
+    }
+    account_lock(stats, blocked);
+    return 0;
+}
+
+void add_lock_stats(lock_stats_t *sum, const lock_stats_t *stats) {
+    sum->acquisitions += __atomic_load_n(&stats->acquisitions, __ATOMIC_RELAXED);
+    sum->contended += __atomic_load_n(&stats->contended, __ATOMIC_RELAXED);
+    sum->blocked_sum_ns += __atomic_load_n(&stats->blocked_sum_ns, __ATOMIC_RELAXED);
+    unsigned long long max = __atomic_load_n(&stats->blocked_max_ns, __ATOMIC_RELAXED);
+    if (max > sum->blocked_max_ns) {
+        sum->blocked_max_ns = max;
+    }
+    for (int i = 0; i < LOCK_BUCKETS; ++i) {
+        sum->histogram[i] += __atomic_load_n(&stats->histogram[i], __ATOMIC_RELAXED);
+    }
+}
+
+
 
+/*
+ * Objects are laid out so that the fields written concurrently by the patrols
+ * and the timer threads (mutexes, counters, sides) start on their own cache
+ * line, away from the fields that are only read after initialization.
+ */
 struct coop {
-    pthread_mutex_t coop_mutex;
+    int mode;
+    int arena_sensors;
+    _Alignas(CACHE_LINE) pthread_mutex_t coop_mutex;
+    lock_stats_t coop_lock;
     int chickens;
+    unsigned long long stolen;
+    /// World of the sensors hunting the coop, so that add_chicken bumps its sequence
+    struct world *world;
 };
 
+error_t setup_coop(coop_t *coop_ptr) {
+    memset(coop_ptr, 0, sizeof(coop_t));
+    if (init_mutex(&coop_ptr->coop_mutex, &coop_ptr->coop_lock) != OK) {
+        return MUTEX;
+    }
+    coop_ptr->chickens = INIT_CHICKENS;
+    telemetry_chickens(coop_ptr->chickens);
+    return OK;
+}
+
+error_t teardown_coop(coop_t *c) {
+    if (pthread_mutex_destroy(&c->coop_mutex)) {
+        return MUTEX;
+    }
+    return OK;
+}
+
 error_t init_coop(coop_t **c) {
     if (!c) {
         return NULL_PTR;
     }
     *c = NULL;
-    coop_t *coop_ptr = malloc(sizeof(coop_t));
+    coop_t *coop_ptr = aligned_alloc(CACHE_LINE, sizeof(coop_t));
     if (!coop_ptr) {
         return MALLOC;
     }
-    if (pthread_mutex_init(&coop_ptr->coop_mutex, NULL)) {
+    error_t res = OK;
+    if ((res = setup_coop(coop_ptr)) != OK) {
         free(coop_ptr);
-        return MUTEX;
+        return res;
     }
-    coop_ptr->chickens = INIT_CHICKENS;
     *c = coop_ptr;
     return OK;
 }
@@ -44,53 +179,65 @@ error_t free_coop(coop_t *c) {
     if (c == NULL) {
         return NULL_PTR;
     }
-    error_t res = OK;
-    if (pthread_mutex_destroy(&c->coop_mutex)) {
-        res = MUTEX;
+    if (c->arena_sensors) {
+        return INVALID_ARGUMENT;
     }
+    error_t res = teardown_coop(c);
     free(c);
     return res;
 }
 
-error_t steal(coop_t *c) {
-    if (!c) {
-        return NULL_PTR;
-    }
-    c->chickens--;
-    printf("A chicken has been stolen! (%d left)\n", c->chickens);
+/*
+ * A steal is made in two parts: take_chicken only stores the new count, with
+ * coop_mutex held and inside a world write section; the count is published
+ * before coop_mutex is released, so that a concurrent add_chicken cannot be
+ * overwritten by a stale one. announce_steal prints and exits on the last
+ * chicken once every lock is released.
+ */
+int take_chicken(coop_t *c) {
     if (!c->chickens) {
+        return -1;
+    }
+    __atomic_store_n(&c->chickens, c->chickens - 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&c->stolen, 1, __ATOMIC_RELAXED);
+    return c->chickens;
+}
+
+void announce_steal(coop_t *c, int left) {
+    if (!(c->mode & COOP_QUIET)) {
+        printf("A chicken has been stolen! (%d left)\n", left);
+    }
+    if (!left && !(c->mode & COOP_NO_EXIT)) {
         printf("No chickens left...\n");
         exit(1);
     }
-    return OK;
 }
 
-error_t get_chickens(coop_t *c, int* chickens) {
-    *chickens = 0;
+error_t set_coop_mode(coop_t *c, int mode) {
     if (!c) {
         return NULL_PTR;
     }
-    if (pthread_mutex_lock(&c->coop_mutex)) {
-        return MUTEX;
-    }
-    *chickens = c->chickens;
-    if (pthread_mutex_unlock(&c->coop_mutex)) {
-        return MUTEX;
+    c->mode = mode;
+    return OK;
+}
+
+error_t get_stolen(coop_t *c, unsigned long long *stolen) {
+    if (!c || !stolen) {
+        return NULL_PTR;
     }
+    *stolen = __atomic_load_n(&c->stolen, __ATOMIC_RELAXED);
     return OK;
 }
 
-error_t add_chicken(coop_t *c) {
+error_t get_chickens(coop_t *c, int* chickens) {
+    *chickens = 0;
     if (!c) {
         return NULL_PTR;
     }
-    if (pthread_mutex_lock(&c->coop_mutex)) {
+    if (timed_lock(&c->coop_mutex, &c->coop_lock)) {
         return MUTEX;
     }
-    if (c->chickens < INIT_CHICKENS) {
-        printf("Adding a new chicken\n");
-        c->chickens++;
-    }
+    *chickens = c->chickens;
     if (pthread_mutex_unlock(&c->coop_mutex)) {
         return MUTEX;
     }
@@ -98,29 +245,219 @@ error_t add_chicken(coop_t *c) {
 }
 
 
+/*
+ * What the patrols did on each side, kept to explain the steals: when the
+ * threat arrived, and when the last sense and alarm were requested, got the
+ * head and ended. Written with relaxed atomics by the patrols and the timers;
+ * a torn read only blurs the attribution of one steal.
+ */
+struct action_trace {
+    unsigned long long request_ns;
+    unsigned long long begin_ns;
+    unsigned long long end_ns;
+};
+
+struct side_trace {
+    unsigned long long arrival_ns;
+    struct action_trace sense;
+    struct action_trace alarm;
+    unsigned long long release_ns;
+    unsigned long long release_late_ns;
+};
+
+#define STEAL_LOG_SIZE 16
+
+/*
+ * Steals by cause and the last annotated ones, written by the timer handlers
+ * inside a world write section.
+ */
+struct steal_log {
+    unsigned long long long_wait_ns;
+    unsigned long long total;
+    unsigned long long causes[STEAL_CAUSES];
+    steal_record_t recent[STEAL_LOG_SIZE];
+};
+
 struct threat {
     timer_t timer;
     unsigned long long time;
-    pthread_mutex_t side_mutex;
+    unsigned long long base_time;
     side_t minside;
     side_t maxside;
+    char* name;
+    int id;
+    struct world *world;
+    unsigned char *mirror;
+    struct side_trace *traces;
+    struct steal_log *steals;
+    threat_script_fn script;
+    void *script_ctx;
+    unsigned long long script_origin_ns;
+    side_t script_side;
+    _Alignas(CACHE_LINE) pthread_mutex_t side_mutex;
+    lock_stats_t side_lock;
     side_t side;
     coop_t* coop;
-    char* name;
+    unsigned long long next_expiry_ns;
+};
+
+/*
+ * Changes that span several fields of the world (a steal and the side chosen
+ * right after it, a head becoming busy, ...) are serialized by the world mutex
+ * of the sensors, created by init_mutex so that the lock protocol applies to
+ * it. Only their plain stores are made inside a write section of the world
+ * seqlock, so that snapshot() never sees them half done: locking, printing or
+ * arming a timer happens outside of the section. Lock order: head mutexes,
+ * then the world mutex, then side_mutex, then coop_mutex.
+ */
+struct world {
+    pthread_mutex_t mutex;
+    lock_stats_t lock;
+    seqlock_t seq;
 };
 
-error_t reset_timer(timer_t timer_id, unsigned long long time) {
+error_t lock_threat(threat_t *threat) {
+    if (threat->world && timed_lock(&threat->world->mutex, &threat->world->lock)) {
+        return MUTEX;
+    }
+    if (timed_lock(&threat->side_mutex, &threat->side_lock)) {
+        if (threat->world) {
+            pthread_mutex_unlock(&threat->world->mutex);
+        }
+        return MUTEX;
+    }
+    return OK;
+}
+
+error_t unlock_threat(threat_t *threat) {
+    error_t res = OK;
+    if (pthread_mutex_unlock(&threat->side_mutex)) {
+        res = MUTEX;
+    }
+    if (threat->world && pthread_mutex_unlock(&threat->world->mutex)) {
+        res = MUTEX;
+    }
+    return res;
+}
+
+void world_write_begin(threat_t *threat) {
+    if (threat->world) {
+        seqlock_update_begin(&threat->world->seq);
+    }
+}
+
+void world_write_end(threat_t *threat) {
+    if (threat->world) {
+        seqlock_update_end(&threat->world->seq);
+    }
+}
+
+error_t add_chicken(coop_t *c) {
+    if (!c) {
+        return NULL_PTR;
+    }
+    // Lock order: the world mutex before coop_mutex, as in handle_timer
+    struct world *world = __atomic_load_n(&c->world, __ATOMIC_ACQUIRE);
+    if (world && timed_lock(&world->mutex, &world->lock)) {
+        return MUTEX;
+    }
+    if (timed_lock(&c->coop_mutex, &c->coop_lock)) {
+        if (world) {
+            pthread_mutex_unlock(&world->mutex);
+        }
+        return MUTEX;
+    }
+    int added = c->chickens < INIT_CHICKENS;
+    if (added) {
+        if (world) {
+            seqlock_update_begin(&world->seq);
+        }
+        __atomic_store_n(&c->chickens, c->chickens + 1, __ATOMIC_RELAXED);
+        if (world) {
+            seqlock_update_end(&world->seq);
+        }
+        telemetry_chickens(c->chickens);
+    }
+    error_t res = OK;
+    if (pthread_mutex_unlock(&c->coop_mutex)) {
+        res = MUTEX;
+    }
+    if (world && pthread_mutex_unlock(&world->mutex)) {
+        res = MUTEX;
+    }
+    if (added && !(c->mode & COOP_QUIET)) {
+        printf("Adding a new chicken\n");
+    }
+    return res;
+}
+
+/*
+ * Timers run on CLOCK_MONOTONIC with an absolute first expiry and a fixed
+ * interval, so the phase of a threat never drifts nor jumps with the wall
+ * clock: the k-th attack always happens at first + k * time.
+ */
+error_t reset_timer(timer_t timer_id, unsigned long long first_ns, unsigned long long time) {
     struct itimerspec ts;
-    ts.it_value.tv_sec = time / 1000;
-    ts.it_value.tv_nsec = (time % 1000) * 1000000;
-    ts.it_interval.tv_sec = ts.it_value.tv_sec;
-    ts.it_interval.tv_nsec = ts.it_value.tv_nsec;
-    if (timer_settime(timer_id, 0, &ts, NULL)) {
+    ts.it_value.tv_sec = first_ns / 1000000000ULL;
+    ts.it_value.tv_nsec = first_ns % 1000000000ULL;
+    ts.it_interval.tv_sec = time / 1000;
+    ts.it_interval.tv_nsec = (time % 1000) * 1000000;
+    if (timer_settime(timer_id, TIMER_ABSTIME, &ts, NULL)) {
         return TIMER_SETTIME;
     }
     return OK;
 }
 
+/*
+ * Scripted threats: the next event is fetched from the script before the
+ * threat is locked (the script may read a file), stored inside the world
+ * write section, then armed as a one-shot timer. Once the script is over, the
+ * threat stays where it is.
+ */
+struct script_event {
+    int valid;
+    unsigned long long when_ns;
+    side_t side;
+};
+
+void fetch_event(threat_t *threat, struct script_event *event) {
+    unsigned long long at;
+    event->valid = threat->script(threat->script_ctx, threat->id, &at, &event->side);
+    // Event times are scaled by set_time_scale like the periods
+    event->when_ns = threat->script_origin_ns + at / threat->base_time * threat->time
+                   + at % threat->base_time * threat->time / threat->base_time;
+}
+
+void store_event(threat_t *threat, const struct script_event *event) {
+    if (event->valid) {
+        threat->script_side = event->side;
+    }
+    __atomic_store_n(&threat->next_expiry_ns, event->valid ? event->when_ns : 0, __ATOMIC_RELAXED);
+}
+
+error_t arm_event(threat_t *threat, const struct script_event *event) {
+    if (!event->valid) {
+        return OK;
+    }
+    return reset_timer(threat->timer, event->when_ns, 0);
+}
+
+/*
+ * Called on each expiry: moves next_expiry_ns to the following period of the
+ * same phase, skipping the periods already missed if the handler ran late.
+ */
+void advance_expiry(threat_t *threat, unsigned long long now) {
+    unsigned long long period = threat->time * 1000000ULL;
+    unsigned long long next = __atomic_load_n(&threat->next_expiry_ns, __ATOMIC_RELAXED);
+    if (!next || !period) {
+        return;
+    }
+    do {
+        next += period;
+    } while (next <= now);
+    __atomic_store_n(&threat->next_expiry_ns, next, __ATOMIC_RELAXED);
+}
+
 error_t stop_timer(timer_t timer_id) {
     struct itimerspec ts = {0};
     if (timer_settime(timer_id, 0, &ts, NULL)) {
@@ -145,15 +482,31 @@ error_t get_maxside(threat_t *threat, side_t *side) {
     return OK;
 }
 
-error_t set_side(threat_t *threat, side_t side) {
-    if (pthread_mutex_lock(&threat->side_mutex)) {
-        return MUTEX;
+/*
+ * Stores the side of a threat, locked with lock_threat, inside a world write
+ * section. now is the arrival time of the threat on the side.
+ */
+void store_side(threat_t *threat, side_t side, unsigned long long now) {
+    __atomic_store_n(&threat->side, side, __ATOMIC_RELAXED);
+    if (threat->mirror) {
+        __atomic_store_n(threat->mirror, (unsigned char) side, __ATOMIC_RELAXED);
+    }
+    if (threat->traces && side != AWAY) {
+        __atomic_store_n(&threat->traces[side-1].arrival_ns, now, __ATOMIC_RELAXED);
     }
-    threat->side = side;
-    if (pthread_mutex_unlock(&threat->side_mutex)) {
+}
+
+error_t set_side(threat_t *threat, side_t side) {
+    if (lock_threat(threat) != OK) {
         return MUTEX;
     }
-    return OK;
+    unsigned long long now = now_ns();
+    world_write_begin(threat);
+    store_side(threat, side, now);
+    world_write_end(threat);
+    error_t res = unlock_threat(threat);
+    telemetry_side(threat->id, side);
+    return res;
 }
 
 error_t get_side(threat_t *threat, side_t *side) {
@@ -161,7 +514,7 @@ error_t get_side(threat_t *threat, side_t *side) {
         return NULL_PTR;
     }
     *side = AWAY;
-    if (pthread_mutex_lock(&threat->side_mutex)) {
+    if (timed_lock(&threat->side_mutex, &threat->side_lock)) {
         return MUTEX;
     }
     *side = threat->side;
@@ -171,36 +524,134 @@ error_t get_side(threat_t *threat, side_t *side) {
     return OK;
 }
 
+side_t random_side(threat_t *threat) {
+    side_t side = rand() % (threat->maxside - threat->minside + 2);
+    if (side != 0) {
+        side += threat->minside - 1;
+    }
+    return side;
+}
+
 error_t chose_side(threat_t *threat) {
     if (!threat) {
         return NULL_PTR;
     }
-    side_t side = rand() % (threat->maxside - threat->minside + 2);
-    if (side != 0) {
-        side += threat->minside - 1;
+    if (threat->script) {
+        // The script alone decides where the threat goes
+        return OK;
     }
-    error_t res = OK;
-    if ((res = set_side(threat, side)) != OK) {
-        return res;
+    return set_side(threat, random_side(threat));
+}
+
+unsigned long long action_wait(const struct action_trace *action, unsigned long long now) {
+    unsigned long long request = __atomic_load_n(&action->request_ns, __ATOMIC_RELAXED);
+    unsigned long long begin = __atomic_load_n(&action->begin_ns, __ATOMIC_RELAXED);
+    return (begin >= request ? begin : now) - request;
+}
+
+/*
+ * Called by the timer handler just before a steal on side: annotates it with
+ * the trace of the side and attributes it to a cause (see enum steal_cause).
+ * The record is logged by log_steal, inside the world write section.
+ */
+void attribute_steal(threat_t *threat, side_t side, unsigned long long now, steal_record_t *out) {
+    const struct side_trace *trace = &threat->traces[side-1];
+    struct steal_log *log = threat->steals;
+    steal_record_t rec = {0};
+    rec.side = side;
+    rec.stolen_ns = now;
+    rec.arrival_ns = __atomic_load_n(&trace->arrival_ns, __ATOMIC_RELAXED);
+    rec.last_sense_ns = __atomic_load_n(&trace->sense.end_ns, __ATOMIC_RELAXED);
+    rec.last_alarm_ns = __atomic_load_n(&trace->alarm.end_ns, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&trace->release_ns, __ATOMIC_RELAXED) >= rec.arrival_ns) {
+        rec.release_late_ns = __atomic_load_n(&trace->release_late_ns, __ATOMIC_RELAXED);
+    }
+    unsigned long long arrival = rec.arrival_ns;
+    unsigned long long long_wait = log->long_wait_ns;
+    if (rec.last_sense_ns >= arrival) {
+        rec.cause = STEAL_ALARM_LATE;
+        if (__atomic_load_n(&trace->alarm.request_ns, __ATOMIC_RELAXED) >= arrival) {
+            rec.lock_wait_ns = action_wait(&trace->alarm, now);
+            if (rec.lock_wait_ns > long_wait) {
+                rec.cause = STEAL_LOCK_BLOCKED;
+            }
+        }
+    } else if (__atomic_load_n(&trace->sense.request_ns, __ATOMIC_RELAXED) >= arrival) {
+        rec.lock_wait_ns = action_wait(&trace->sense, now);
+        if (rec.lock_wait_ns > long_wait) {
+            rec.cause = STEAL_LOCK_BLOCKED;
+        } else if (rec.release_late_ns > long_wait) {
+            rec.cause = STEAL_LATE_RELEASE;
+        } else {
+            rec.cause = STEAL_SENSE_LATE;
+        }
+    } else {
+        rec.cause = rec.release_late_ns > long_wait ? STEAL_LATE_RELEASE : STEAL_NEVER_SENSED;
     }
-    return reset_timer(threat->timer, threat->time);
+    *out = rec;
 }
 
-error_t steal_chicken(coop_t* coop) {
-    return steal(coop);
+void log_steal(struct steal_log *log, const steal_record_t *rec) {
+    log->recent[log->total % STEAL_LOG_SIZE] = *rec;
+    __atomic_store_n(&log->total, log->total + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&log->causes[rec->cause], log->causes[rec->cause] + 1, __ATOMIC_RELAXED);
 }
 
 void handle_timer(union sigval sig) {
     threat_t *threat = sig.sival_ptr;
-    if (threat) {
-        side_t side;
-        get_side(threat, &side);
-        if (side >= threat->minside && side <= threat->maxside) {
-            if (threat->coop) {
-                steal_chicken(threat->coop);
-            }
+    if (!threat) {
+        return;
+    }
+    struct script_event event = {0};
+    if (threat->script && threat->coop) {
+        fetch_event(threat, &event);
+    }
+    if (lock_threat(threat) != OK) {
+        return;
+    }
+    coop_t *coop = threat->coop;
+    if (!coop) {
+        // Late expiry of a stopped hunt: the threat must stay AWAY and the script not be re-armed
+        unlock_threat(threat);
+        return;
+    }
+    side_t side = threat->side;
+    side_t next = threat->script ? threat->script_side : random_side(threat);
+    unsigned long long now = now_ns();
+    int stealing = side >= threat->minside && side <= threat->maxside;
+    steal_record_t rec;
+    if (stealing && threat->traces && threat->steals) {
+        attribute_steal(threat, side, now, &rec);
+    }
+    if (stealing && timed_lock(&coop->coop_mutex, &coop->coop_lock)) {
+        stealing = 0;
+    }
+    int left = -1;
+    world_write_begin(threat);
+    if (stealing && (left = take_chicken(coop)) >= 0 && threat->traces && threat->steals) {
+        log_steal(threat->steals, &rec);
+    }
+    store_side(threat, next, now);
+    if (threat->script) {
+        store_event(threat, &event);
+    } else {
+        advance_expiry(threat, now);
+    }
+    world_write_end(threat);
+    if (stealing) {
+        if (left >= 0) {
+            telemetry_chickens(left);
         }
-        chose_side(threat);
+        pthread_mutex_unlock(&coop->coop_mutex);
+    }
+    if (threat->script) {
+        arm_event(threat, &event);
+    }
+    unlock_threat(threat);
+    telemetry_side(threat->id, next);
+    if (left >= 0) {
+        telemetry_steal(side);
+        announce_steal(coop, left);
     }
 }
 
@@ -213,7 +664,7 @@ error_t create_timer(threat_t *threat, timer_t *timer_id) {
     se.sigev_notify_function = handle_timer;
     se.sigev_value.sival_ptr = threat;
     se.sigev_notify_attributes = NULL;
-    if (timer_create(CLOCK_REALTIME, &se, timer_id)) {
+    if (timer_create(CLOCK_MONOTONIC, &se, timer_id)) {
         return TIMER_CREATE;
     }
     return OK;
@@ -223,15 +674,30 @@ error_t threat_hunt(threat_t *threat, coop_t *coop) {
     if (!threat || !coop) {
         return NULL_PTR;
     }
-    threat->coop = coop;
     error_t res = OK;
-    if ((res = set_side(threat, AWAY)) != OK) {
-        return res;
+    struct script_event event = {0};
+    if (threat->script) {
+        fetch_event(threat, &event);
     }
-    if ((res = reset_timer(threat->timer, threat->time)) != OK) {
+    if ((res = lock_threat(threat)) != OK) {
         return res;
     }
-    return OK;
+    unsigned long long now = now_ns();
+    unsigned long long first = now + threat->time * 1000000ULL;
+    world_write_begin(threat);
+    __atomic_store_n(&threat->coop, coop, __ATOMIC_RELAXED);
+    __atomic_store_n(&coop->world, threat->world, __ATOMIC_RELEASE);
+    store_side(threat, AWAY, now);
+    if (threat->script) {
+        store_event(threat, &event);
+    } else {
+        __atomic_store_n(&threat->next_expiry_ns, first, __ATOMIC_RELAXED);
+    }
+    world_write_end(threat);
+    res = threat->script ? arm_event(threat, &event) : reset_timer(threat->timer, first, threat->time);
+    error_t tmp_res = unlock_threat(threat);
+    telemetry_side(threat->id, AWAY);
+    return res != OK ? res : tmp_res;
 }
 
 error_t threat_stop_hunt(threat_t *threat) {
@@ -242,43 +708,44 @@ error_t threat_stop_hunt(threat_t *threat) {
     if ((res = stop_timer(threat->timer)) != OK) {
         return res;
     }
-    if ((res = set_side(threat, AWAY)) != OK) {
+    if ((res = lock_threat(threat)) != OK) {
         return res;
     }
-    threat->coop = NULL;
+    unsigned long long now = now_ns();
+    coop_t *coop = threat->coop;
+    world_write_begin(threat);
+    __atomic_store_n(&threat->next_expiry_ns, 0, __ATOMIC_RELAXED);
+    store_side(threat, AWAY, now);
+    __atomic_store_n(&threat->coop, NULL, __ATOMIC_RELAXED);
+    struct world *world = threat->world;
+    if (coop) {
+        // The world may be freed after stop_hunt: add_chicken must not use it any more
+        __atomic_compare_exchange_n(&coop->world, &world, NULL, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+    world_write_end(threat);
+    res = unlock_threat(threat);
+    telemetry_side(threat->id, AWAY);
     return res;
 }
 
-error_t init_threat(threat_t **threat) {
-    if (!threat) {
-        return NULL_PTR;
-    }
-    *threat = NULL;
-    threat_t *threat_ptr = calloc(1, sizeof(struct threat));
-    if (!threat_ptr) {
-        return MALLOC;
-    }
+error_t setup_threat(threat_t *threat_ptr) {
+    memset(threat_ptr, 0, sizeof(struct threat));
     threat_ptr->side = AWAY;
     threat_ptr->coop = NULL;
     error_t res = OK;
     if ((res = create_timer(threat_ptr, &threat_ptr->timer)) != OK) {
         return res;
     }
-    if (pthread_mutex_init(&threat_ptr->side_mutex, NULL)) {
+    if (init_mutex(&threat_ptr->side_mutex, &threat_ptr->side_lock) != OK) {
         if (timer_delete(threat_ptr->timer)) {
             return TIMER_DELETE;
         }
         return MUTEX;
     }
-    *threat = threat_ptr;
     return res;
-
 }
 
-error_t free_threat(threat_t *threat) {
-    if (!threat) {
-        return NULL_PTR;
-    }
+error_t teardown_threat(threat_t *threat) {
     error_t res = OK;
     error_t temp_res = OK;
     res = threat_stop_hunt(threat);
@@ -288,19 +755,61 @@ error_t free_threat(threat_t *threat) {
     if ((temp_res = pthread_mutex_destroy(&threat->side_mutex)) != OK) {
         res = temp_res;
     }
+    return res;
+}
+
+error_t init_threat(threat_t **threat) {
+    if (!threat) {
+        return NULL_PTR;
+    }
+    *threat = NULL;
+    threat_t *threat_ptr = aligned_alloc(CACHE_LINE, sizeof(struct threat));
+    if (!threat_ptr) {
+        return MALLOC;
+    }
+    error_t res = OK;
+    if ((res = setup_threat(threat_ptr)) != OK) {
+        free(threat_ptr);
+        return res;
+    }
+    *threat = threat_ptr;
+    return res;
+
+}
+
+error_t free_threat(threat_t *threat) {
+    if (!threat) {
+        return NULL_PTR;
+    }
+    error_t res = teardown_threat(threat);
     free(threat);
     return res;
 }
 
+void make_fox(threat_t *fox) {
+    fox->minside = NORTH;
+    fox->maxside = EAST;
+    fox->time = FOX_TIME;
+    fox->base_time = FOX_TIME;
+    fox->name = "FOX";
+    fox->id = FOX_THREAT;
+}
+
+void make_eagle(threat_t *eagle) {
+    eagle->minside = ABOVE;
+    eagle->maxside = ABOVE;
+    eagle->time = EAGLE_TIME;
+    eagle->base_time = EAGLE_TIME;
+    eagle->name = "EAGLE";
+    eagle->id = EAGLE_THREAT;
+}
+
 error_t init_fox(threat_t **fox) {
     error_t res = OK;
     if ((res = init_threat(fox)) != OK) {
         return res;
     }
-    (*fox)->minside = NORTH;
-    (*fox)->maxside = EAST;
-    (*fox)->time = FOX_TIME;
-    (*fox)->name = "FOX";
+    make_fox(*fox);
     return OK;
 }
 
@@ -309,10 +818,7 @@ error_t init_eagle(threat_t **eagle) {
     if ((res = init_threat(eagle)) != OK) {
         return res;
     }
-    (*eagle)->minside = ABOVE;
-    (*eagle)->maxside = ABOVE;
-    (*eagle)->time = EAGLE_TIME;
-    (*eagle)->name = "EAGLE";
+    make_eagle(*eagle);
     return OK;
 }
 
@@ -325,11 +831,11 @@ unsigned long long int _measure_loop(unsigned long long int iter, int *r) {
     *r = 0;
     unsigned long long int nanotime = 0;
     struct timespec begin = { 0 }, end = { 0 };
-    clock_gettime(CLOCK_REALTIME, &begin);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
     for (unsigned long long int i = 0; i < iter; ++i) {
         *r ^= i;
     }
-    clock_gettime(CLOCK_REALTIME, &end);
+    clock_gettime(CLOCK_MONOTONIC, &end);
     nanotime = (end.tv_sec - begin.tv_sec) * 1000000000 + end.tv_nsec - begin.tv_nsec;
     return nanotime;
 }
@@ -356,28 +862,45 @@ unsigned long long int _compute_iterations(unsigned long long int delay) {
     return middle;
 }
 
+/*
+ * The busy loop of a step is calibrated once per process: the machine does
+ * not change between two sensors_t, and calibrating takes tens of ms.
+ */
+pthread_once_t calibration_once = PTHREAD_ONCE_INIT;
+unsigned long long int calibrated_iter_for_ms;
+
+void calibrate(void) {
+    calibrated_iter_for_ms = _compute_iterations(1000000ULL);
+}
+
+struct sensor_head {
+    _Alignas(CACHE_LINE) pthread_mutex_t action_mutex;
+    lock_stats_t action_lock;
+    side_t busy_side;
+};
+
 struct sensors {
     unsigned long long int iter_for_ms;
-    pthread_mutex_t action_mutex;
+    unsigned long long int step_iter;
+    unsigned long long int step_ns;
+    int nb_heads;
+    int in_arena;
+    unsigned int head_of[NUM_ACTIVE_POS];
     unsigned int positions[NUM_ACTIVE_POS];
-    threat_t *threats[2];
+    threat_t *threats[NUM_THREATS];
+    _Alignas(CACHE_LINE) struct world world;
+    unsigned long long senses;
+    unsigned long long alarms;
+    struct steal_log steals;
+    _Alignas(CACHE_LINE) struct side_trace traces[NUM_ACTIVE_POS];
+    struct sensor_head heads[MAX_SENSOR_HEADS];
 };
 
-error_t init_sensors(sensors_t **sensors_v) {
-    if (!sensors_v) {
-        return NULL_PTR;
-    }
-    error_t res = OK;
-    struct sensors* sensors = calloc(1, sizeof(struct sensors));
-    if (!sensors) {
-        return MALLOC;
-    }
-    if ((res = init_fox(&sensors->threats[0])) != OK) {
-        goto fox_error;
-    }
-    if ((res = init_eagle(&sensors->threats[1])) != OK) {
-        goto eagle_error;
-    }
+/*
+ * Sets up sensors whose threats are already set up. On error, nothing is left
+ * to tear down in the sensors themselves.
+ */
+error_t setup_sensors(struct sensors *sensors, int heads) {
     for (int i = 0; i < 2; ++i) {
         side_t minside;
         side_t maxside;
@@ -387,39 +910,256 @@ error_t init_sensors(sensors_t **sensors_v) {
             sensors->positions[j-1] = i;
         }
     }
-    sensors->iter_for_ms = _compute_iterations(1000000ULL);
-    pthread_mutex_init(&sensors->action_mutex, NULL);
-    if (res != OK) {
-eagle_error:
-        free_threat(sensors->threats[0]);
-fox_error:
-        free(sensors);
-        sensors = NULL;
+    for (int i = 0; i < NUM_ACTIVE_POS; ++i) {
+        sensors->head_of[i] = i % heads;
     }
-    *sensors_v = sensors;
-    return res;
-}
-
-error_t free_sensors(sensors_t *sensors) {
-    if (!sensors) {
-        return NULL_PTR;
+    pthread_once(&calibration_once, calibrate);
+    sensors->iter_for_ms = calibrated_iter_for_ms;
+    sensors->step_iter = sensors->iter_for_ms*(STEP_TIME-JITTER);
+    sensors->step_ns = (STEP_TIME-JITTER) * 1000000ULL;
+    sensors->steals.long_wait_ns = JITTER * 1000000ULL;
+    if (init_mutex(&sensors->world.mutex, &sensors->world.lock) != OK) {
+        return MUTEX;
+    }
+    int h;
+    for (h = 0; h < heads; ++h) {
+        if (init_mutex(&sensors->heads[h].action_mutex, &sensors->heads[h].action_lock) != OK) {
+            while (h-- > 0) {
+                pthread_mutex_destroy(&sensors->heads[h].action_mutex);
+            }
+            pthread_mutex_destroy(&sensors->world.mutex);
+            return MUTEX;
+        }
     }
+    sensors->nb_heads = heads;
+    // Linked last: on error, the threats are torn down without a world
+    for (int i = 0; i < NUM_THREATS; ++i) {
+        sensors->threats[i]->world = &sensors->world;
+        sensors->threats[i]->traces = sensors->traces;
+        sensors->threats[i]->steals = &sensors->steals;
+    }
+    return OK;
+}
+
+error_t teardown_sensors(struct sensors *sensors) {
     error_t res = OK;
-    error_t tmp_res = OK;
-    if (pthread_mutex_destroy(&sensors->action_mutex)) {
+    for (int h = 0; h < sensors->nb_heads; ++h) {
+        if (pthread_mutex_destroy(&sensors->heads[h].action_mutex)) {
+            res = MUTEX;
+        }
+    }
+    if (pthread_mutex_destroy(&sensors->world.mutex)) {
         res = MUTEX;
     }
+    return res;
+}
+
+error_t init_sensors_heads(sensors_t **sensors_v, int heads) {
+    if (!sensors_v) {
+        return NULL_PTR;
+    }
+    *sensors_v = NULL;
+    if (heads < 1 || heads > MAX_SENSOR_HEADS) {
+        return INVALID_HEAD;
+    }
+    error_t res = OK;
+    struct sensors* sensors = aligned_alloc(CACHE_LINE, sizeof(struct sensors));
+    if (!sensors) {
+        return MALLOC;
+    }
+    memset(sensors, 0, sizeof(struct sensors));
+    if ((res = init_fox(&sensors->threats[0])) != OK) {
+        goto fox_error;
+    }
+    if ((res = init_eagle(&sensors->threats[1])) != OK) {
+        goto eagle_error;
+    }
+    res = setup_sensors(sensors, heads);
+    if (res != OK) {
+        free_threat(sensors->threats[1]);
+eagle_error:
+        free_threat(sensors->threats[0]);
+fox_error:
+        free(sensors);
+        sensors = NULL;
+    }
+    *sensors_v = sensors;
+    return res;
+}
+
+error_t init_sensors(sensors_t **sensors_v) {
+    return init_sensors_heads(sensors_v, 1);
+}
+
+error_t assign_head(sensors_t *sensors, side_t side, int head) {
+    if (!sensors) {
+        return NULL_PTR;
+    }
+    if (side < MIN_ACTIVE_POS || side > MAX_ACTIVE_POS) {
+        return INVALID_POSITION;
+    }
+    if (head < 0 || head >= sensors->nb_heads) {
+        return INVALID_HEAD;
+    }
+    sensors->head_of[side-1] = head;
+    return OK;
+}
+
+error_t set_time_scale(sensors_t *sensors, unsigned int divisor) {
+    if (!sensors) {
+        return NULL_PTR;
+    }
+    if (divisor < 1 || divisor > EAGLE_TIME) {
+        return INVALID_ARGUMENT;
+    }
+    for (int i = 0; i < NUM_THREATS; ++i) {
+        sensors->threats[i]->time = sensors->threats[i]->base_time / divisor;
+    }
+    sensors->step_iter = sensors->iter_for_ms*(STEP_TIME-JITTER) / divisor;
+    sensors->step_ns = (STEP_TIME-JITTER) * 1000000ULL / divisor;
+    sensors->steals.long_wait_ns = JITTER * 1000000ULL / divisor;
+    return OK;
+}
+
+error_t free_sensors(sensors_t *sensors) {
+    if (!sensors) {
+        return NULL_PTR;
+    }
+    if (sensors->in_arena) {
+        return INVALID_ARGUMENT;
+    }
+    error_t res = OK;
+    error_t tmp_res = OK;
+    // The threats are stopped first, under the world mutex of the sensors
     for (int i = 0; i < 2; ++i) {
         if ((tmp_res = free_threat(sensors->threats[i])) != OK) {
             res = tmp_res;
         }
     }
+    if ((tmp_res = teardown_sensors(sensors)) != OK) {
+        res = tmp_res;
+    }
     free(sensors);
     return res;
 }
 
+/*
+ * Layout of an arena: the coop, then the read-mostly parts of every sensors_t
+ * next to each other, then the threats. Every object size is a multiple of
+ * CACHE_LINE, so each one starts on its own cache line.
+ */
+struct sensors *arena_sensors(coop_t *c, int i) {
+    return (struct sensors *) ((char *) c + sizeof(coop_t) + i * sizeof(struct sensors));
+}
+
+threat_t *arena_threat(coop_t *c, int i) {
+    return (threat_t *) ((char *) arena_sensors(c, c->arena_sensors) + i * sizeof(struct threat));
+}
+
+error_t teardown_arena(coop_t *c, int built) {
+    error_t res = OK;
+    error_t tmp_res = OK;
+    for (int i = 0; i < built; ++i) {
+        struct sensors *sensors = arena_sensors(c, i);
+        for (int j = 0; j < NUM_THREATS; ++j) {
+            if ((tmp_res = teardown_threat(sensors->threats[j])) != OK) {
+                res = tmp_res;
+            }
+        }
+        if ((tmp_res = teardown_sensors(sensors)) != OK) {
+            res = tmp_res;
+        }
+    }
+    if ((tmp_res = teardown_coop(c)) != OK) {
+        res = tmp_res;
+    }
+    return res;
+}
+
+error_t init_coop_arena(coop_t **c, sensors_t **sensors, int count, int heads) {
+    if (!c || !sensors) {
+        return NULL_PTR;
+    }
+    *c = NULL;
+    if (count < 1) {
+        return INVALID_ARGUMENT;
+    }
+    if (heads < 1 || heads > MAX_SENSOR_HEADS) {
+        return INVALID_HEAD;
+    }
+    size_t size = sizeof(coop_t) + count * (sizeof(struct sensors) + NUM_THREATS * sizeof(struct threat));
+    coop_t *coop = aligned_alloc(CACHE_LINE, size);
+    if (!coop) {
+        return MALLOC;
+    }
+    error_t res = OK;
+    if ((res = setup_coop(coop)) != OK) {
+        free(coop);
+        return res;
+    }
+    coop->arena_sensors = count;
+    int built;
+    for (built = 0; built < count; ++built) {
+        struct sensors *s = arena_sensors(coop, built);
+        threat_t *fox = arena_threat(coop, built * NUM_THREATS + FOX_THREAT);
+        threat_t *eagle = arena_threat(coop, built * NUM_THREATS + EAGLE_THREAT);
+        memset(s, 0, sizeof(struct sensors));
+        s->in_arena = 1;
+        if ((res = setup_threat(fox)) != OK) {
+            break;
+        }
+        make_fox(fox);
+        if ((res = setup_threat(eagle)) != OK) {
+            teardown_threat(fox);
+            break;
+        }
+        make_eagle(eagle);
+        s->threats[FOX_THREAT] = fox;
+        s->threats[EAGLE_THREAT] = eagle;
+        if ((res = setup_sensors(s, heads)) != OK) {
+            teardown_threat(eagle);
+            teardown_threat(fox);
+            break;
+        }
+        sensors[built] = s;
+    }
+    if (res != OK) {
+        teardown_arena(coop, built);
+        free(coop);
+        return res;
+    }
+    *c = coop;
+    return OK;
+}
+
+error_t free_coop_arena(coop_t *c) {
+    if (!c) {
+        return NULL_PTR;
+    }
+    if (!c->arena_sensors) {
+        return INVALID_ARGUMENT;
+    }
+    error_t res = teardown_arena(c, c->arena_sensors);
+    free(c);
+    return res;
+}
+
+error_t script_threats(sensors_t *sensors, threat_script_fn next, void *ctx) {
+    if (!sensors) {
+        return NULL_PTR;
+    }
+    for (int i = 0; i < NUM_THREATS; ++i) {
+        sensors->threats[i]->script = next;
+        sensors->threats[i]->script_ctx = ctx;
+    }
+    return OK;
+}
+
 error_t start_hunt(sensors_t* sensors, coop_t* coop) {
+    // Scripted events of both threats count from the same origin
+    unsigned long long origin = now_ns();
     for (int i = 0; i < 2; ++i) {
+        sensors->threats[i]->script_origin_ns = origin;
         threat_hunt(sensors->threats[i], coop);
     }
     return OK;
@@ -432,6 +1172,142 @@ error_t stop_hunt(sensors_t* sensors) {
     return OK;
 }
 
+/*
+ * Locks every head whose bit is set in mask, always in increasing order so
+ * that concurrent multi-side actions cannot deadlock.
+ */
+error_t lock_heads(sensors_t *sensors, unsigned int mask) {
+    for (int h = 0; h < sensors->nb_heads; ++h) {
+        if (!(mask & (1u << h))) {
+            continue;
+        }
+        if (timed_lock(&sensors->heads[h].action_mutex, &sensors->heads[h].action_lock)) {
+            while (h-- > 0) {
+                if (mask & (1u << h)) {
+                    pthread_mutex_unlock(&sensors->heads[h].action_mutex);
+                }
+            }
+            return MUTEX;
+        }
+    }
+    return OK;
+}
+
+void unlock_heads(sensors_t *sensors, unsigned int mask) {
+    for (int h = sensors->nb_heads - 1; h >= 0; --h) {
+        if (mask & (1u << h)) {
+            pthread_mutex_unlock(&sensors->heads[h].action_mutex);
+        }
+    }
+}
+
+void do_steps(sensors_t *sensors, unsigned int steps) {
+    unsigned long long int begin = now_ns();
+    for (unsigned long long int i = 0; i < steps*sensors->step_iter; ++i) {}
+    unsigned long long int end = now_ns();
+    if (steps) {
+        telemetry_step((end - begin) / steps, end);
+    }
+}
+
+error_t heads_begin(sensors_t *sensors, const side_t *sides, int count) {
+    if (timed_lock(&sensors->world.mutex, &sensors->world.lock)) {
+        return MUTEX;
+    }
+    seqlock_update_begin(&sensors->world.seq);
+    for (int i = 0; i < count; ++i) {
+        struct sensor_head *head = &sensors->heads[sensors->head_of[sides[i]-1]];
+        __atomic_store_n(&head->busy_side, sides[i], __ATOMIC_RELAXED);
+    }
+    seqlock_update_end(&sensors->world.seq);
+    if (pthread_mutex_unlock(&sensors->world.mutex)) {
+        return MUTEX;
+    }
+    return OK;
+}
+
+error_t heads_end(sensors_t *sensors, unsigned int mask, unsigned long long *counter, int count) {
+    if (timed_lock(&sensors->world.mutex, &sensors->world.lock)) {
+        return MUTEX;
+    }
+    seqlock_update_begin(&sensors->world.seq);
+    for (int h = 0; h < sensors->nb_heads; ++h) {
+        if (mask & (1u << h)) {
+            __atomic_store_n(&sensors->heads[h].busy_side, AWAY, __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(counter, *counter + count, __ATOMIC_RELAXED);
+    seqlock_update_end(&sensors->world.seq);
+    if (pthread_mutex_unlock(&sensors->world.mutex)) {
+        return MUTEX;
+    }
+    return OK;
+}
+
+/*
+ * Stamps the request, start or end (0 leaves it unchanged) of a sense or an
+ * alarm in the trace of each side, for the attribution of steals.
+ */
+void trace_sides(sensors_t *sensors, const side_t *sides, int count, int alarm,
+                 unsigned long long request_ns, unsigned long long begin_ns, unsigned long long end_ns) {
+    for (int i = 0; i < count; ++i) {
+        struct side_trace *trace = &sensors->traces[sides[i]-1];
+        struct action_trace *action = alarm ? &trace->alarm : &trace->sense;
+        if (request_ns) {
+            __atomic_store_n(&action->request_ns, request_ns, __ATOMIC_RELAXED);
+        }
+        if (begin_ns) {
+            __atomic_store_n(&action->begin_ns, begin_ns, __ATOMIC_RELAXED);
+        }
+        if (end_ns) {
+            __atomic_store_n(&action->end_ns, end_ns, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+threat_t *threat_on(sensors_t *sensors, side_t side) {
+    return sensors->threats[sensors->positions[side-1]];
+}
+
+/*
+ * What a step does once it has elapsed, with the head of the side held.
+ */
+error_t detect(sensors_t *sensors, side_t side, sense_t *result) {
+    *result = ERROR;
+    threat_t *threat = threat_on(sensors, side);
+    if (!threat) {
+        return NULL_PTR;
+    }
+    side_t threat_side;
+    error_t res = OK;
+    if ((res = get_side(threat, &threat_side)) != OK) {
+        return res;
+    }
+    *result = NORMAL;
+    if (threat_side == side) {
+        *result = DETECTED;
+        telemetry_detect(side);
+    }
+    return OK;
+}
+
+error_t chase(sensors_t *sensors, side_t side) {
+    telemetry_alarm(side);
+    threat_t *threat = threat_on(sensors, side);
+    if (!threat) {
+        return NULL_PTR;
+    }
+    side_t threat_side;
+    error_t res = OK;
+    if ((res = get_side(threat, &threat_side)) != OK) {
+        return res;
+    }
+    if (threat_side == side) {
+        return set_side(threat, AWAY);
+    }
+    return chose_side(threat);
+}
+
 sense_t sense(sensors_t* sensors, side_t side, error_t *error_ptr) {
     sense_t res = NORMAL;
     error_t err = OK;
@@ -440,34 +1316,31 @@ sense_t sense(sensors_t* sensors, side_t side, error_t *error_ptr) {
         err = NULL_PTR;
         goto mutex_error;
     }
-    if (pthread_mutex_lock(&sensors->action_mutex)) {
-        res = ERROR;
-        err = MUTEX;
-        goto mutex_error;
-    }
-    for (unsigned long long int i = 0; i < sensors->iter_for_ms*(STEP_TIME-JITTER); ++i) {}
     if (side < MIN_ACTIVE_POS || side > MAX_ACTIVE_POS) {
         res = ERROR;
         err = INVALID_POSITION;
-        goto mutex_unlock;
+        goto mutex_error;
     }
-    int threat_pos = sensors->positions[side-1];
-    threat_t *threat = sensors->threats[threat_pos];
-    if (!threat) {
+    unsigned int mask = 1u << sensors->head_of[side-1];
+    trace_sides(sensors, &side, 1, 0, now_ns(), 0, 0);
+    if ((err = lock_heads(sensors, mask)) != OK) {
         res = ERROR;
-        err = NULL_PTR;
-        goto mutex_unlock;
+        goto mutex_error;
     }
-    side_t threat_side;
-    if ((err = get_side(threat, &threat_side)) != OK) {
+    trace_sides(sensors, &side, 1, 0, 0, now_ns(), 0);
+    if ((err = heads_begin(sensors, &side, 1)) != OK) {
         res = ERROR;
-        goto mutex_unlock;
+        unlock_heads(sensors, mask);
+        goto mutex_error;
     }
-    if (threat_side == side) {
-        res = DETECTED;
+    do_steps(sensors, 1);
+    err = detect(sensors, side, &res);
+    trace_sides(sensors, &side, 1, 0, 0, 0, now_ns());
+    if (heads_end(sensors, mask, &sensors->senses, 1) != OK && err == OK) {
+        res = ERROR;
+        err = MUTEX;
     }
-mutex_unlock:
-    pthread_mutex_unlock(&sensors->action_mutex);
+    unlock_heads(sensors, mask);
 mutex_error:
     if (error_ptr) {
         *error_ptr = err;
@@ -475,45 +1348,345 @@ mutex_error:
     return res;
 }
 
+error_t sense_multi(sensors_t *sensors, const side_t *sides, int count, sense_t *results) {
+    if (!sensors || !sides || !results) {
+        return NULL_PTR;
+    }
+    unsigned int mask = 0;
+    unsigned int per_head[MAX_SENSOR_HEADS] = {0};
+    unsigned int steps = 0;
+    for (int i = 0; i < count; ++i) {
+        results[i] = ERROR;
+        if (sides[i] < MIN_ACTIVE_POS || sides[i] > MAX_ACTIVE_POS) {
+            return INVALID_POSITION;
+        }
+        unsigned int head = sensors->head_of[sides[i]-1];
+        mask |= 1u << head;
+        if (++per_head[head] > steps) {
+            steps = per_head[head];
+        }
+    }
+    error_t res = OK;
+    trace_sides(sensors, sides, count, 0, now_ns(), 0, 0);
+    if ((res = lock_heads(sensors, mask)) != OK) {
+        return res;
+    }
+    trace_sides(sensors, sides, count, 0, 0, now_ns(), 0);
+    if ((res = heads_begin(sensors, sides, count)) != OK) {
+        unlock_heads(sensors, mask);
+        return res;
+    }
+    do_steps(sensors, steps);
+    for (int i = 0; i < count && res == OK; ++i) {
+        res = detect(sensors, sides[i], &results[i]);
+    }
+    trace_sides(sensors, sides, count, 0, 0, 0, now_ns());
+    if (heads_end(sensors, mask, &sensors->senses, count) != OK && res == OK) {
+        res = MUTEX;
+    }
+    unlock_heads(sensors, mask);
+    return res;
+}
+
 
 error_t sound_alarm(sensors_t *sensors, side_t side) {
     if (!sensors) {
         return NULL_PTR;
     }
+    if (side < MIN_ACTIVE_POS || side > MAX_ACTIVE_POS) {
+        return INVALID_POSITION;
+    }
     error_t res = OK;
-    if (pthread_mutex_lock(&sensors->action_mutex)) {
-        res = MUTEX;
+    unsigned int mask = 1u << sensors->head_of[side-1];
+    trace_sides(sensors, &side, 1, 1, now_ns(), 0, 0);
+    if ((res = lock_heads(sensors, mask)) != OK) {
+        goto mutex_lock_error;
+    }
+    trace_sides(sensors, &side, 1, 1, 0, now_ns(), 0);
+    if ((res = heads_begin(sensors, &side, 1)) != OK) {
+        unlock_heads(sensors, mask);
         goto mutex_lock_error;
     }
-    for (unsigned long long int i = 0; i < sensors->iter_for_ms*(STEP_TIME-JITTER); ++i) {}
+    do_steps(sensors, 1);
+    res = chase(sensors, side);
+    trace_sides(sensors, &side, 1, 1, 0, 0, now_ns());
+    if (heads_end(sensors, mask, &sensors->alarms, 1) != OK && res == OK) {
+        res = MUTEX;
+    }
+    unlock_heads(sensors, mask);
+mutex_lock_error:
+    return res;
+}
+
+error_t step_begin(sensors_t *sensors, side_t side, step_t *step) {
+    if (!sensors || !step) {
+        return NULL_PTR;
+    }
     if (side < MIN_ACTIVE_POS || side > MAX_ACTIVE_POS) {
-        res = INVALID_POSITION;
-        goto unlock_mutex;
+        return INVALID_POSITION;
     }
-    int threat_pos = sensors->positions[side-1];
-    threat_t *threat = sensors->threats[threat_pos];
-    if (!threat) {
-        res = NULL_PTR;
-        goto unlock_mutex;
+    unsigned int head = sensors->head_of[side-1];
+    int err = pthread_mutex_trylock(&sensors->heads[head].action_mutex);
+    if (err) {
+        return err == EBUSY ? WOULD_BLOCK : MUTEX;
     }
-    side_t threat_side;
-    error_t tmp_res = OK;
-    if ((tmp_res = get_side(threat, &threat_side)) != OK) {
-        res = tmp_res;
-        goto unlock_mutex;
+    account_lock(&sensors->heads[head].action_lock, 0);
+    if (heads_begin(sensors, &side, 1) != OK) {
+        pthread_mutex_unlock(&sensors->heads[head].action_mutex);
+        return MUTEX;
     }
-    if (sensors && threat_side == side) {
-        if ((tmp_res = set_side(threat, AWAY)) != OK) {
-            res = tmp_res;
-            goto unlock_mutex;
+    step->sensors = sensors;
+    step->side = side;
+    step->mask = 1u << head;
+    step->begin_ns = now_ns();
+    step->end_ns = step->begin_ns + sensors->step_ns;
+    return OK;
+}
+
+int step_done(const step_t *step) {
+    return now_ns() >= step->end_ns;
+}
+
+sense_t sense_end(step_t *step, error_t *error_ptr) {
+    sense_t res = ERROR;
+    error_t err = NULL_PTR;
+    if (step && step->mask) {
+        unsigned long long int end = now_ns();
+        telemetry_step(end - step->begin_ns, end);
+        err = detect(step->sensors, step->side, &res);
+        trace_sides(step->sensors, &step->side, 1, 0, step->begin_ns, step->begin_ns, end);
+        if (heads_end(step->sensors, step->mask, &step->sensors->senses, 1) != OK && err == OK) {
+            res = ERROR;
+            err = MUTEX;
         }
-    } else {
-        res = chose_side(threat);
+        unlock_heads(step->sensors, step->mask);
+        step->mask = 0;
     }
-unlock_mutex:
-    pthread_mutex_unlock(&sensors->action_mutex);
-mutex_lock_error:
+    if (error_ptr) {
+        *error_ptr = err;
+    }
+    return res;
+}
+
+error_t alarm_end(step_t *step) {
+    if (!step || !step->mask) {
+        return NULL_PTR;
+    }
+    unsigned long long int end = now_ns();
+    telemetry_step(end - step->begin_ns, end);
+    error_t res = chase(step->sensors, step->side);
+    trace_sides(step->sensors, &step->side, 1, 1, step->begin_ns, step->begin_ns, end);
+    if (heads_end(step->sensors, step->mask, &step->sensors->alarms, 1) != OK && res == OK) {
+        res = MUTEX;
+    }
+    unlock_heads(step->sensors, step->mask);
+    step->mask = 0;
     return res;
 }
 
+error_t snapshot(sensors_t *sensors, snapshot_t *snap) {
+    if (!sensors || !snap) {
+        return NULL_PTR;
+    }
+    unsigned int seq;
+    do {
+        seq = seqlock_read_begin(&sensors->world.seq);
+        snap->version = seq >> 1;
+        coop_t *coop = __atomic_load_n(&sensors->threats[FOX_THREAT]->coop, __ATOMIC_RELAXED);
+        snap->chickens = coop ? __atomic_load_n(&coop->chickens, __ATOMIC_RELAXED) : 0;
+        for (int i = 0; i < NUM_THREATS; ++i) {
+            threat_t *threat = sensors->threats[i];
+            snap->threat_side[i] = __atomic_load_n(&threat->side, __ATOMIC_RELAXED);
+            snap->next_expiry_ns[i] = __atomic_load_n(&threat->next_expiry_ns, __ATOMIC_RELAXED);
+            snap->period_ms[i] = threat->time;
+        }
+        for (int h = 0; h < MAX_SENSOR_HEADS; ++h) {
+            snap->head_side[h] = h < sensors->nb_heads
+                ? __atomic_load_n(&sensors->heads[h].busy_side, __ATOMIC_RELAXED) : AWAY;
+        }
+        snap->senses = __atomic_load_n(&sensors->senses, __ATOMIC_RELAXED);
+        snap->alarms = __atomic_load_n(&sensors->alarms, __ATOMIC_RELAXED);
+        if (seq & 1) {
+            sched_yield();
+        }
+    } while (seqlock_read_retry(&sensors->world.seq, seq));
+    return OK;
+}
+
+error_t get_next_expiry(sensors_t *sensors, side_t side, struct timespec *expiry) {
+    if (!sensors || !expiry) {
+        return NULL_PTR;
+    }
+    if (side < MIN_ACTIVE_POS || side > MAX_ACTIVE_POS) {
+        return INVALID_POSITION;
+    }
+    threat_t *threat = threat_on(sensors, side);
+    unsigned long long next = __atomic_load_n(&threat->next_expiry_ns, __ATOMIC_RELAXED);
+    expiry->tv_sec = next / 1000000000ULL;
+    expiry->tv_nsec = next % 1000000000ULL;
+    return OK;
+}
+
+error_t mirror_sides(sensors_t *sensors, unsigned char *slots[NUM_THREATS]) {
+    if (!sensors) {
+        return NULL_PTR;
+    }
+    for (int i = 0; i < NUM_THREATS; ++i) {
+        threat_t *threat = sensors->threats[i];
+        if (timed_lock(&threat->side_mutex, &threat->side_lock)) {
+            return MUTEX;
+        }
+        threat->mirror = slots ? slots[i] : NULL;
+        if (threat->mirror) {
+            __atomic_store_n(threat->mirror, (unsigned char) threat->side, __ATOMIC_RELAXED);
+        }
+        if (pthread_mutex_unlock(&threat->side_mutex)) {
+            return MUTEX;
+        }
+    }
+    return OK;
+}
 
+error_t record_patrol_release(sensors_t *sensors, const side_t *sides, int count,
+                              const struct timespec *release) {
+    if (!sensors || !sides || !release) {
+        return NULL_PTR;
+    }
+    for (int i = 0; i < count; ++i) {
+        if (sides[i] < MIN_ACTIVE_POS || sides[i] > MAX_ACTIVE_POS) {
+            return INVALID_POSITION;
+        }
+    }
+    unsigned long long release_ns = release->tv_sec * 1000000000ULL + release->tv_nsec;
+    unsigned long long now = now_ns();
+    unsigned long long late = now > release_ns ? now - release_ns : 0;
+    for (int i = 0; i < count; ++i) {
+        struct side_trace *trace = &sensors->traces[sides[i]-1];
+        __atomic_store_n(&trace->release_late_ns, late, __ATOMIC_RELAXED);
+        __atomic_store_n(&trace->release_ns, release_ns, __ATOMIC_RELAXED);
+    }
+    return OK;
+}
+
+/*
+ * Prints a time of a steal record relative to the steal, "-" if it never happened.
+ */
+void print_relative_ms(FILE *out, unsigned long long t, unsigned long long ref) {
+    if (!t) {
+        fprintf(out, " %12s", "-");
+    } else {
+        fprintf(out, " %12.1f", ((long long) t - (long long) ref) / 1e6);
+    }
+}
+
+error_t steal_report(sensors_t *sensors, FILE *out) {
+    if (!sensors || !out) {
+        return NULL_PTR;
+    }
+    static const char *cause_names[STEAL_CAUSES] = {
+        "never sensed", "late release", "lock blocked", "sense late", "alarm late"
+    };
+    static const char *side_names[] = {"AWAY", "NORTH", "SOUTH", "EAST", "ABOVE"};
+    struct steal_log log;
+    unsigned int seq;
+    do {
+        seq = seqlock_read_begin(&sensors->world.seq);
+        log = sensors->steals;
+        if (seq & 1) {
+            sched_yield();
+        }
+    } while (seqlock_read_retry(&sensors->world.seq, seq));
+    fprintf(out, "%llu steals\n", log.total);
+    for (int c = 0; c < STEAL_CAUSES; ++c) {
+        fprintf(out, "%-14s %8llu %6.1f%%\n", cause_names[c], log.causes[c],
+                log.total ? 100.0 * log.causes[c] / log.total : 0.0);
+    }
+    if (!log.total) {
+        return OK;
+    }
+    unsigned long long first = log.total > STEAL_LOG_SIZE ? log.total - STEAL_LOG_SIZE : 0;
+    fprintf(out, "last steals, times in ms relative to the steal:\n");
+    fprintf(out, "%-6s %-14s %12s %12s %12s %12s %12s\n", "side", "cause", "arrival", "last sense",
+            "last alarm", "lock wait", "release late");
+    for (unsigned long long i = first; i < log.total; ++i) {
+        const steal_record_t *rec = &log.recent[i % STEAL_LOG_SIZE];
+        fprintf(out, "%-6s %-14s", side_names[rec->side], cause_names[rec->cause]);
+        print_relative_ms(out, rec->arrival_ns, rec->stolen_ns);
+        print_relative_ms(out, rec->last_sense_ns, rec->stolen_ns);
+        print_relative_ms(out, rec->last_alarm_ns, rec->stolen_ns);
+        fprintf(out, " %12.1f %12.1f\n", rec->lock_wait_ns / 1e6, rec->release_late_ns / 1e6);
+    }
+    return OK;
+}
+
+error_t get_lock_stats(sensors_t *sensors, coop_t *c, enum lock_kind kind, lock_stats_t *stats) {
+    if (!stats) {
+        return NULL_PTR;
+    }
+    memset(stats, 0, sizeof(lock_stats_t));
+    if (kind == LOCK_COOP) {
+        if (!c) {
+            return NULL_PTR;
+        }
+        add_lock_stats(stats, &c->coop_lock);
+        return OK;
+    }
+    if (!sensors) {
+        return NULL_PTR;
+    }
+    if (kind == LOCK_ACTION) {
+        for (int h = 0; h < sensors->nb_heads; ++h) {
+            add_lock_stats(stats, &sensors->heads[h].action_lock);
+        }
+    } else if (kind == LOCK_SIDE) {
+        for (int i = 0; i < NUM_THREATS; ++i) {
+            add_lock_stats(stats, &sensors->threats[i]->side_lock);
+        }
+    } else if (kind == LOCK_WORLD) {
+        add_lock_stats(stats, &sensors->world.lock);
+    } else {
+        return INVALID_ARGUMENT;
+    }
+    return OK;
+}
+
+void print_lock_stats(FILE *out, const char *name, const lock_stats_t *stats) {
+    lock_stats_t s = {0};
+    add_lock_stats(&s, stats);
+    fprintf(out, "%-16s %10llu %10llu %12.3f %12.3f ", name, s.acquisitions, s.contended,
+            s.contended ? s.blocked_sum_ns / 1e6 / s.contended : 0.0, s.blocked_max_ns / 1e6);
+    for (int i = 0; i < LOCK_BUCKETS; ++i) {
+        if (s.histogram[i] && i == LOCK_BUCKETS - 1) {
+            fprintf(out, " >=%lluus:%llu", 1ULL << (i - 1), s.histogram[i]);
+        } else if (s.histogram[i]) {
+            fprintf(out, " <%lluus:%llu", 1ULL << i, s.histogram[i]);
+        }
+    }
+    fprintf(out, "\n");
+}
+
+error_t lock_report(sensors_t *sensors, coop_t *c, FILE *out) {
+    if (!out) {
+        return NULL_PTR;
+    }
+    static const char *protocol_names[] = {"none", "inherit", "protect"};
+    fprintf(out, "protocol %s\n", protocol_names[lock_protocol]);
+    fprintf(out, "%-16s %10s %10s %12s %12s  %s\n", "lock", "taken", "contended", "wait avg ms",
+            "wait max ms", "histogram of the waits");
+    char name[32];
+    if (sensors) {
+        for (int h = 0; h < sensors->nb_heads; ++h) {
+            snprintf(name, sizeof(name), "action_mutex[%d]", h);
+            print_lock_stats(out, name, &sensors->heads[h].action_lock);
+        }
+        for (int i = 0; i < NUM_THREATS; ++i) {
+            snprintf(name, sizeof(name), "side_mutex %s", sensors->threats[i]->name);
+            print_lock_stats(out, name, &sensors->threats[i]->side_lock);
+        }
+        print_lock_stats(out, "world_mutex", &sensors->world.lock);
+    }
+    if (c) {
+        print_lock_stats(out, "coop_mutex", &c->coop_lock);
+    }
+    return OK;
+}
@@ -10,6 +10,10 @@
 
 #pragma once
 
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
 
 // --- Constants and Macros ---
 
@@ -45,6 +49,21 @@
  */
 #define JITTER 100ULL
 
+/**
+ * @def MAX_SENSOR_HEADS
+ * @brief Maximum number of sensor heads. Each head can sense or sound the
+ * alarm on one side per step, independently of the other heads.
+ */
+#define MAX_SENSOR_HEADS 4
+
+/**
+ * @def LOCK_BUCKETS
+ * @brief Number of buckets of the blocking-time histogram of a lock.
+ * Bucket 0 counts waits under 1 us, bucket k the waits in [2^(k-1), 2^k) us,
+ * and the last bucket every longer wait.
+ */
+#define LOCK_BUCKETS 24
+
 
 // --- Enumerations and Typedefs ---
 
@@ -71,6 +90,18 @@ enum error {
     TIMER_DELETE = 6,
     /// Mutex error. Concurrency problem.  (the mutex could not be created, destroyed, locked, unlocked, etc.)
     MUTEX = 7,
+    /// The sensor head given as input was invalid (e.g., out of range)
+    INVALID_HEAD = 8,
+    /// Shared-memory error (the segment could not be created, mapped, read, etc.)
+    SHM = 9,
+    /// An argument was out of its valid range
+    INVALID_ARGUMENT = 10,
+    /// The resource is busy and the call would have to wait, try again later
+    WOULD_BLOCK = 11,
+    /// The request was refused by a policy check (e.g., a task failing the schedulability test)
+    REJECTED = 12,
+    /// File error (the file could not be opened or mapped, or its format is invalid)
+    FILE_ERROR = 13,
 };
 
 /**
@@ -128,6 +159,204 @@ enum sense_result {
 typedef enum sense_result sense_t;
 
 
+/**
+ * @enum coop_mode
+ * @brief Flags changing how the coop reacts to steals, see set_coop_mode.
+ */
+enum coop_mode {
+    /// Do not print a message on each steal or added chicken
+    COOP_QUIET = 1,
+    /// Do not exit when the last chicken is stolen, the coop just stays empty
+    COOP_NO_EXIT = 2,
+};
+
+/**
+ * @enum threat_index
+ * @brief Index of each threat in the arrays of snapshot_t.
+ */
+enum threat_index {
+    /// The fox, hunting on NORTH, SOUTH and EAST
+    FOX_THREAT = 0,
+    /// The eagle, hunting ABOVE
+    EAGLE_THREAT = 1,
+    /// Number of threats
+    NUM_THREATS = 2,
+};
+
+/**
+ * @struct snapshot
+ * @brief Consistent view of the whole system at one point in time.
+ */
+struct snapshot {
+    /// Number of changes made to the system before this view was taken
+    unsigned int version;
+    /// Number of chickens in the hunted coop (0 if no hunt is running)
+    int chickens;
+    /// Side of each threat, indexed by enum threat_index
+    side_t threat_side[NUM_THREATS];
+    /// CLOCK_MONOTONIC time (ns) of the next attack of each threat, 0 if stopped
+    unsigned long long next_expiry_ns[NUM_THREATS];
+    /// Period (ms) of each threat
+    unsigned long long period_ms[NUM_THREATS];
+    /// Side served by each sensor head right now, AWAY if the head is idle
+    side_t head_side[MAX_SENSOR_HEADS];
+    /// Number of sides sensed so far
+    unsigned long long senses;
+    /// Number of alarms sounded so far
+    unsigned long long alarms;
+};
+
+/**
+ * @struct step
+ * @brief A sensor action in progress, started with step_begin.
+ *
+ * The fields are managed by the step functions and must not be changed.
+ */
+struct step {
+    /// The sensors performing the step
+    struct sensors *sensors;
+    /// The side the step is about
+    side_t side;
+    /// Heads held by the step, 0 once it has ended
+    unsigned int mask;
+    /// CLOCK_MONOTONIC time (ns) at which the step started
+    unsigned long long begin_ns;
+    /// CLOCK_MONOTONIC time (ns) at which the step has elapsed
+    unsigned long long end_ns;
+};
+
+/**
+ * @enum steal_cause
+ * @brief Why the patrols did not prevent a steal.
+ *
+ * A sense or alarm counts for a steal only if it was requested after the
+ * threat arrived on the side. Delays are "long" beyond JITTER (scaled like
+ * the steps by set_time_scale).
+ */
+enum steal_cause {
+    /// No sense of the side was requested between the arrival and the steal
+    STEAL_NEVER_SENSED = 0,
+    /// The patrol of the side was released long after its release time
+    STEAL_LATE_RELEASE = 1,
+    /// The sense or the alarm waited long for the head of the side (action_mutex)
+    STEAL_LOCK_BLOCKED = 2,
+    /// The sense started too close to the steal to end before it
+    STEAL_SENSE_LATE = 3,
+    /// The threat was sensed, but the alarm did not end before the steal
+    STEAL_ALARM_LATE = 4,
+    /// Number of causes
+    STEAL_CAUSES = 5,
+};
+
+/**
+ * @struct steal_record
+ * @brief A steal annotated with what the patrols did on its side. Times are
+ * CLOCK_MONOTONIC (ns), 0 when the event never happened.
+ */
+struct steal_record {
+    /// The side the chicken was stolen from
+    side_t side;
+    /// The cause attributed to the steal
+    enum steal_cause cause;
+    /// When the chicken was stolen
+    unsigned long long stolen_ns;
+    /// When the threat arrived on the side
+    unsigned long long arrival_ns;
+    /// End of the last sense of the side
+    unsigned long long last_sense_ns;
+    /// End of the last alarm on the side
+    unsigned long long last_alarm_ns;
+    /// Time the sense (or alarm) after the arrival waited for the head
+    unsigned long long lock_wait_ns;
+    /// Release lateness of the patrol of the side after the arrival
+    unsigned long long release_late_ns;
+};
+
+/**
+ * @typedef steal_record_t
+ * @brief Typedef for an annotated steal.
+ * @see struct steal_record
+ */
+typedef struct steal_record steal_record_t;
+
+/**
+ * @enum lock_protocol
+ * @brief Protocol of the mutexes of the system, see set_lock_protocol.
+ */
+enum lock_protocol {
+    /// Default mutexes, a low-priority holder can delay a high-priority waiter without bound
+    LOCK_PRIO_NONE = 0,
+    /// PTHREAD_PRIO_INHERIT: the holder runs at the priority of its highest waiter
+    LOCK_PRIO_INHERIT = 1,
+    /// PTHREAD_PRIO_PROTECT: the holder runs at the ceiling priority of the mutex
+    LOCK_PRIO_PROTECT = 2,
+};
+
+/**
+ * @enum lock_kind
+ * @brief The mutexes of the system.
+ */
+enum lock_kind {
+    /// action_mutex of each sensor head
+    LOCK_ACTION = 0,
+    /// coop_mutex of the coop
+    LOCK_COOP = 1,
+    /// side_mutex of each threat
+    LOCK_SIDE = 2,
+    /// world_mutex serializing the changes seen together by snapshot
+    LOCK_WORLD = 3,
+    /// Number of kinds
+    LOCK_KINDS = 4,
+};
+
+/**
+ * @struct lock_stats
+ * @brief Blocking times of a mutex (ns), i.e., how long lockers waited for it.
+ */
+struct lock_stats {
+    /// Number of times the mutex was taken
+    unsigned long long acquisitions;
+    /// Number of times it was already held and the locker had to wait
+    unsigned long long contended;
+    /// Total and longest wait
+    unsigned long long blocked_sum_ns, blocked_max_ns;
+    /// Distribution of the waits, see LOCK_BUCKETS
+    unsigned long long histogram[LOCK_BUCKETS];
+};
+
+/**
+ * @typedef lock_stats_t
+ * @brief Typedef for the blocking times of a mutex.
+ * @see struct lock_stats
+ */
+typedef struct lock_stats lock_stats_t;
+
+/**
+ * @typedef threat_script_fn
+ * @brief Source of the scripted events of a threat, see script_threats.
+ *
+ * Called from the timer thread of the threat, with its index (enum
+ * threat_index), each time the threat needs its next event. Sets the time of
+ * the event, in ns since start_hunt, and the side the threat moves to at that
+ * time. Returns 0 once the threat has no more events.
+ */
+typedef int (*threat_script_fn)(void *ctx, int threat, unsigned long long *at_ns, side_t *side);
+
+/**
+ * @typedef step_t
+ * @brief Typedef for a sensor action in progress.
+ * @see struct step
+ */
+typedef struct step step_t;
+
+/**
+ * @typedef snapshot_t
+ * @brief Typedef for the consistent view of the system.
+ * @see struct snapshot
+ */
+typedef struct snapshot snapshot_t;
+
+
 // --- Opaque Structures ---
 
 /**
@@ -143,6 +372,16 @@ typedef struct coop coop_t;
 typedef struct sensors sensors_t;
 
 
+// --- Time Functions ---
+
+/**
+ * @brief Gives the CLOCK_MONOTONIC time, the clock of every time of the system.
+ *
+ * @return unsigned long long The current time (ns).
+ */
+unsigned long long now_ns(void);
+
+
 // --- Sensor Functions ---
 
 /**
@@ -155,6 +394,46 @@ typedef struct sensors sensors_t;
  */
 error_t init_sensors(sensors_t **sensors);
 
+/**
+ * @brief Initialize the sensor with several independent sensor heads.
+ *
+ * Each head has its own lock, so actions on sides served by different heads
+ * can run in parallel. Sides are assigned to heads in a round-robin fashion
+ * (NORTH on head 0, SOUTH on head 1, ...). init_sensors is equivalent to
+ * init_sensors_heads with a single head.
+ * Sensor must be freed after using free_sensors.
+ *
+ * @param sensors Takes a pointer to a pointer of type sensors_t, which will be set.
+ * @param heads Number of sensor heads, between 1 and MAX_SENSOR_HEADS.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t init_sensors_heads(sensors_t **sensors, int heads);
+
+/**
+ * @brief Assigns a side to a sensor head.
+ *
+ * Must not be called while sense or sound_alarm may run concurrently.
+ *
+ * @param sensors Takes a pointer to a sensors_t.
+ * @param side The side to assign.
+ * @param head The head that will serve the side.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t assign_head(sensors_t *sensors, side_t side, int head);
+
+/**
+ * @brief Speeds up the whole simulation by a constant factor.
+ *
+ * The periods of the threats and the duration of a step are divided by
+ * divisor, so that benchmarks can run many periods in a short time. Must be
+ * called before start_hunt.
+ *
+ * @param sensors Takes a pointer to a sensors_t.
+ * @param divisor Speed-up factor, between 1 (real time) and EAGLE_TIME.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t set_time_scale(sensors_t *sensors, unsigned int divisor);
+
 /**
  * @brief Frees the dynamically allocated resources.
  *
@@ -163,11 +442,30 @@ error_t init_sensors(sensors_t **sensors);
  */
 error_t free_sensors(sensors_t *sensors);
 
+/**
+ * @brief Makes the threats follow a script instead of choosing sides at random.
+ *
+ * Each event of a threat acts as an expiry of its timer: if the threat is on
+ * an active side, it steals a chicken, then it moves to the side of the event
+ * (AWAY included). Between events the threat stays where it is, except when
+ * an alarm on its side chases it away; an alarm on another side no longer
+ * moves it. get_next_expiry gives the time of the next event. Event times are
+ * divided by the factor of set_time_scale like the periods. Must be called
+ * before start_hunt.
+ *
+ * @param sensors Takes a pointer to a sensors_t.
+ * @param next The source of the events, NULL to go back to random sides.
+ * @param ctx Passed to next.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t script_threats(sensors_t *sensors, threat_script_fn next, void *ctx);
+
 /**
  * @brief Starts the two threats (eagle and fox).
  *
  * **Important**: If the number of chickens reaches zero, the code calls the
- * exit function, causing the program to stop.
+ * exit function, causing the program to stop, unless the coop is in
+ * COOP_NO_EXIT mode (see set_coop_mode).
  *
  * @param sensors Takes a pointer to a sensors_t.
  * @param coop Takes a pointer to a coop_t.
@@ -188,7 +486,7 @@ error_t stop_hunt(sensors_t* sensors);
  *
  * The pointer to error_t can be NULL. If it is *not NULL*, it will be set
  * in case of error to give more information.
- * Uses a mutex to be thread-safe.
+ * Uses the mutex of the head serving the side to be thread-safe.
  * Takes STEP_TIME ms.
  *
  * @param sensors Takes a pointer to a sensors_t.
@@ -198,13 +496,32 @@ error_t stop_hunt(sensors_t* sensors);
  */
 sense_t sense(sensors_t *sensors, side_t side, error_t *error);
 
+/**
+ * @brief Senses on several sides at once.
+ *
+ * The heads serving the given sides are locked together (in increasing
+ * order), then each head senses its sides one step at a time. The call
+ * therefore takes STEP_TIME ms times the largest number of sides given to
+ * a single head: with one head per side, any set of sides is sensed in a
+ * single step.
+ * Uses the head mutexes to be thread-safe.
+ *
+ * @param sensors Takes a pointer to a sensors_t.
+ * @param sides Array of sides to sense on.
+ * @param count Number of sides in the array.
+ * @param results Array of count sense_t, set to DETECTED or NORMAL.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t sense_multi(sensors_t *sensors, const side_t *sides, int count, sense_t *results);
+
 /**
  * @brief Sounds the alarm on the given side.
  *
  * If a threat was on that side, it is chased away and won't steal a
- * chicken until its next period.
+ * chicken until its next period. Otherwise, the threat watching that side
+ * chooses a new side, keeping its phase.
  * Takes a pointer to a sensors_t and a side_t.
- * Uses a mutex to be thread-safe.
+ * Uses the mutex of the head serving the side to be thread-safe.
  * Takes STEP_TIME ms.
  *
  * @param sensors Takes a pointer to a sensors_t.
@@ -213,6 +530,122 @@ sense_t sense(sensors_t *sensors, side_t side, error_t *error);
  */
 error_t sound_alarm(sensors_t *sensors, side_t side);
 
+/**
+ * @brief Starts a step on a side without blocking, for cooperative schedulers.
+ *
+ * The head serving the side is taken with a try-lock. Unlike sense and
+ * sound_alarm, the step does not burn the CPU: it elapses on its own and the
+ * caller can run other work until step_done returns non-zero, then finishes
+ * it with sense_end or alarm_end, from the same thread. A step_t that started
+ * must always be finished, otherwise its head stays locked.
+ *
+ * @param sensors Takes a pointer to a sensors_t.
+ * @param side The side to sense on or sound the alarm on.
+ * @param step Pointer to the step_t to fill.
+ * @return error_t Returns OK, WOULD_BLOCK if the head is busy, or an error code.
+ */
+error_t step_begin(sensors_t *sensors, side_t side, step_t *step);
+
+/**
+ * @brief Tells whether a step started with step_begin has elapsed.
+ *
+ * @param step Pointer to the step_t.
+ * @return int Non-zero once the step can be finished.
+ */
+int step_done(const step_t *step);
+
+/**
+ * @brief Finishes a step as a sense, like sense would at the end of its step.
+ *
+ * @param step Pointer to the elapsed step_t.
+ * @param error Pointer to an error_t output parameter (can be NULL).
+ * @return sense_t Returns a sense_t (DETECTED, NORMAL, or ERROR).
+ */
+sense_t sense_end(step_t *step, error_t *error);
+
+/**
+ * @brief Finishes a step as an alarm, like sound_alarm would at the end of its step.
+ *
+ * @param step Pointer to the elapsed step_t.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t alarm_end(step_t *step);
+
+/**
+ * @brief Gives the time of the next attack of the threat hunting on a side.
+ *
+ * Threats attack periodically on CLOCK_MONOTONIC with a fixed phase: at each
+ * expiry, a threat on an active side steals a chicken, then chooses its next
+ * side. Sounding the alarm does not change the phase. Patrols can therefore
+ * sleep until just before the next expiry (clock_nanosleep with
+ * CLOCK_MONOTONIC and TIMER_ABSTIME) instead of spending the whole period.
+ *
+ * @param sensors Takes a pointer to a sensors_t.
+ * @param side A side watched by the threat (e.g., NORTH for the fox).
+ * @param expiry Set to the CLOCK_MONOTONIC time of the next expiry, or to
+ * zero if the threat is not hunting.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t get_next_expiry(sensors_t *sensors, side_t side, struct timespec *expiry);
+
+/**
+ * @brief Mirrors the side of each threat into a byte owned by the caller.
+ *
+ * From now on, every change of side of a threat is also stored in its byte,
+ * so that sides of many coops can be laid out contiguously (see farm.h).
+ * The bytes are set to the current sides before the call returns.
+ *
+ * @param sensors Takes a pointer to a sensors_t.
+ * @param slots One byte per threat, indexed by enum threat_index, or NULL to stop mirroring.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t mirror_sides(sensors_t *sensors, unsigned char *slots[NUM_THREATS]);
+
+/**
+ * @brief Records that the patrol of some sides was released, for steal attribution.
+ *
+ * To be called by a periodic patrol when it wakes up, with the time it
+ * should have woken up at; the difference is its release lateness.
+ *
+ * @param sensors Takes a pointer to a sensors_t.
+ * @param sides The sides the patrol is about to scan.
+ * @param count The number of sides.
+ * @param release The CLOCK_MONOTONIC release time of the patrol.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t record_patrol_release(sensors_t *sensors, const side_t *sides, int count,
+                              const struct timespec *release);
+
+/**
+ * @brief Prints the steals classified by cause, then the last annotated steals.
+ *
+ * Every steal is attributed to a cause when it happens, from the arrival of
+ * the threat, the last sense and alarm on the side, the time they waited for
+ * the head and the release lateness of the patrol (see enum steal_cause).
+ * Without COOP_NO_EXIT the last steal exits from the timer thread, before
+ * any report: set it and end the run from the main thread instead.
+ *
+ * @param sensors Takes a pointer to a sensors_t.
+ * @param out Stream to print to.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t steal_report(sensors_t *sensors, FILE *out);
+
+/**
+ * @brief Takes a consistent view of the chickens, the threats and the sensors.
+ *
+ * Changes spanning several fields (e.g., a steal and the side chosen by the
+ * threat right after it) are versioned, and the view is taken again if one
+ * happened while it was copied. The call never takes the mutexes of the
+ * system and never delays sense, sound_alarm or the threats, so it can be
+ * used at a high frequency.
+ *
+ * @param sensors Takes a pointer to a sensors_t.
+ * @param snap Pointer to the snapshot_t which will be filled.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t snapshot(sensors_t *sensors, snapshot_t *snap);
+
 
 // --- Coop Functions ---
 
@@ -232,6 +665,34 @@ error_t init_coop(coop_t **c);
  */
 error_t free_coop(coop_t *c);
 
+/**
+ * @brief Initializes a coop and the sensors watching it in a single block.
+ *
+ * The coop, count sensors_t and their threats are placed contiguously in one
+ * cache-line-aligned allocation, and the fields written concurrently (locks,
+ * counters, threat sides) sit on their own cache lines. This avoids false
+ * sharing when many coops run side by side.
+ * Objects created here must be freed with free_coop_arena only: free_coop and
+ * free_sensors return INVALID_ARGUMENT on them.
+ *
+ * @param c Pointer to a pointer of type coop_t, which will be set.
+ * @param sensors Array of count pointers of type sensors_t, which will be set.
+ * @param count Number of sensors_t (each with its fox and eagle) to create.
+ * @param heads Number of heads of each sensors_t, between 1 and MAX_SENSOR_HEADS.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t init_coop_arena(coop_t **c, sensors_t **sensors, int count, int heads);
+
+/**
+ * @brief Frees a coop created with init_coop_arena and all its sensors.
+ *
+ * The hunts of the sensors are stopped first.
+ *
+ * @param c Pointer to the coop instance.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t free_coop_arena(coop_t *c);
+
 /**
  * @brief Writes the number of chickens remaining in the pointer.
  *
@@ -248,10 +709,83 @@ error_t get_chickens(coop_t *c, int* chickens);
  * @brief Adds one chicken to the coop.
  *
  * Adds one chicken to the coop if the number of chickens is lower than
- * INIT_CHICKEN. Uses a mutex to be thread-safe.
+ * INIT_CHICKEN. Uses a mutex to be thread-safe; while the coop is hunted,
+ * the new count is stored inside a write section of the sensors' world, so
+ * that snapshot sees it with a new version.
  *
  * @param c Pointer to the coop instance.
  * @return error_t Returns an error_t (OK or error code).
  */
 error_t add_chicken(coop_t *c);
 
+/**
+ * @brief Changes how the coop reacts to steals.
+ *
+ * By default, every steal is printed and the program exits when no chicken
+ * is left.
+ *
+ * @param c Pointer to the coop instance.
+ * @param mode Combination of enum coop_mode flags (0 for the default behavior).
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t set_coop_mode(coop_t *c, int mode);
+
+/**
+ * @brief Writes the total number of chickens stolen from the coop.
+ *
+ * @param c Pointer to the coop instance.
+ * @param stolen Pointer to the counter output parameter.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t get_stolen(coop_t *c, unsigned long long *stolen);
+
+/**
+ * @brief Chooses the protocol of the mutexes created from now on.
+ *
+ * Applies to the action_mutex, coop_mutex, side_mutex and world_mutex of the
+ * coops and sensors initialized after the call, not to existing ones. With
+ * LOCK_PRIO_PROTECT, locking raises the holder to the ceiling, which needs
+ * the right to use SCHED_FIFO (e.g., CAP_SYS_NICE); sense, sound_alarm, ...
+ * then return MUTEX if it is missing.
+ *
+ * @param protocol The protocol, see enum lock_protocol.
+ * @param ceiling The SCHED_FIFO ceiling priority, used by LOCK_PRIO_PROTECT only.
+ * @return error_t Returns INVALID_ARGUMENT if the protocol or the ceiling is invalid.
+ */
+error_t set_lock_protocol(enum lock_protocol protocol, int ceiling);
+
+/**
+ * @brief Initializes a mutex with the protocol chosen by set_lock_protocol.
+ *
+ * For the mutexes that the caller shares between its tasks, so that they
+ * follow the same protocol as those of the system.
+ *
+ * @param mutex Pointer to the mutex to initialize, destroyed with pthread_mutex_destroy.
+ * @param stats Pointer to blocking times to reset (can be NULL).
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t init_mutex(pthread_mutex_t *mutex, lock_stats_t *stats);
+
+/**
+ * @brief Sums the blocking times of the mutexes of one kind.
+ *
+ * The blocked_max_ns of the result is the longest wait on any of them, which
+ * bounds the blocking term B of the response-time analysis of a task using them.
+ *
+ * @param sensors The sensors holding the other mutexes (can be NULL for LOCK_COOP).
+ * @param c The coop holding the coop_mutex (can be NULL for the other kinds).
+ * @param kind The kind of mutex.
+ * @param stats Pointer to the lock_stats_t which will be filled.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t get_lock_stats(sensors_t *sensors, coop_t *c, enum lock_kind kind, lock_stats_t *stats);
+
+/**
+ * @brief Prints the blocking times of every mutex of the sensors and of the coop.
+ *
+ * @param sensors Takes a pointer to a sensors_t (can be NULL).
+ * @param c Pointer to the coop instance (can be NULL).
+ * @param out Stream to print to.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t lock_report(sensors_t *sensors, coop_t *c, FILE *out);
@@ -0,0 +1,67 @@
+/**
+ * @file coroutine.h
+ * @brief Stackless coroutines (protothreads) for cooperative patrol tasks.
+ *
+ * A coroutine is a function that is called again and again by a scheduler
+ * and resumes where it last waited, thanks to a switch on the line number
+ * saved in its co_t. It has no stack of its own: everything that must survive
+ * a wait lives in the structure of the task, not in local variables.
+ * Blocking calls are forbidden inside a coroutine; waits are expressed with
+ * CO_WAIT_UNTIL, giving the scheduler the time at which to check again.
+ */
+
+
+#pragma once
+
+
+/**
+ * @struct co
+ * @brief Resume point and wake-up time of a coroutine.
+ */
+typedef struct co {
+    /// Line to resume from, 0 before the first call
+    int line;
+    /// CLOCK_MONOTONIC time (ns) before which the coroutine need not be called
+    unsigned long long wake_ns;
+} co_t;
+
+/**
+ * @enum co_state
+ * @brief Value returned by a coroutine to its scheduler.
+ */
+enum co_state {
+    /// The coroutine waits for a condition, call it again at wake_ns
+    CO_WAITING = 0,
+    /// The coroutine has finished
+    CO_DONE = 1,
+};
+
+/**
+ * @def CO_BEGIN
+ * @brief Must be the first statement of a coroutine.
+ */
+#define CO_BEGIN(co) switch ((co)->line) { case 0:
+
+/**
+ * @def CO_WAIT_UNTIL
+ * @brief Returns to the scheduler until cond is true, checked again at wake.
+ *
+ * cond is evaluated on every call until it holds: to wait for a call that
+ * can also fail, store its result in the task and test it after the wait.
+ */
+#define CO_WAIT_UNTIL(co, cond, wake) \
+    do { \
+        (co)->line = __LINE__; \
+        __attribute__((fallthrough)); \
+        case __LINE__: \
+        if (!(cond)) { \
+            (co)->wake_ns = (wake); \
+            return CO_WAITING; \
+        } \
+    } while (0)
+
+/**
+ * @def CO_END
+ * @brief Must be the last statement of a coroutine.
+ */
+#define CO_END(co) } (co)->line = 0; return CO_DONE
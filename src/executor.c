@@ -0,0 +1,364 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "executor.h"
+
+// How long an idle worker sleeps before looking for work to steal again
+#define EXECUTOR_IDLE_NS 1000000ULL
+
+
+struct job {
+    const char *name;
+    job_fn fn;
+    void *arg;
+    unsigned long long release_ns;
+    unsigned long long period_ns;
+    unsigned long long deadline_ns;
+    job_stats_t stats;
+};
+
+struct worker {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    /// Released jobs, sorted by decreasing absolute deadline: the most urgent is last
+    struct job **ready;
+    int nb_ready;
+    /// Jobs waiting for their next release, min-heap on release_ns
+    struct job **sleeping;
+    int nb_sleeping;
+    struct executor *ex;
+    unsigned int seed;
+    unsigned long long runs;
+    unsigned long long steals;
+};
+
+struct executor {
+    int nb_workers;
+    struct worker *workers;
+    struct job *jobs;
+    int nb_jobs;
+    int cap_jobs;
+    int running;
+    int started;
+};
+
+static unsigned long long absolute_deadline(const struct job *job) {
+    return job->release_ns + job->deadline_ns;
+}
+
+static void heap_push(struct worker *w, struct job *job) {
+    int i = w->nb_sleeping++;
+    while (i > 0 && w->sleeping[(i - 1) / 2]->release_ns > job->release_ns) {
+        w->sleeping[i] = w->sleeping[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    w->sleeping[i] = job;
+}
+
+static struct job *heap_pop(struct worker *w) {
+    struct job *top = w->sleeping[0];
+    struct job *last = w->sleeping[--w->nb_sleeping];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= w->nb_sleeping) {
+            break;
+        }
+        if (child + 1 < w->nb_sleeping && w->sleeping[child + 1]->release_ns < w->sleeping[child]->release_ns) {
+            child++;
+        }
+        if (w->sleeping[child]->release_ns >= last->release_ns) {
+            break;
+        }
+        w->sleeping[i] = w->sleeping[child];
+        i = child;
+    }
+    w->sleeping[i] = last;
+    return top;
+}
+
+static void ready_push(struct worker *w, struct job *job) {
+    int i = w->nb_ready++;
+    while (i > 0 && absolute_deadline(w->ready[i - 1]) < absolute_deadline(job)) {
+        w->ready[i] = w->ready[i - 1];
+        i--;
+    }
+    w->ready[i] = job;
+}
+
+/*
+ * Moves the jobs whose release time has come to the ready deque. Called with
+ * the lock of the worker held, by the worker itself or by a thief, so that the
+ * jobs of a worker busy with a long job can still be stolen.
+ */
+static void release_due(struct worker *w, unsigned long long now) {
+    while (w->nb_sleeping && w->sleeping[0]->release_ns <= now) {
+        ready_push(w, heap_pop(w));
+    }
+}
+
+static struct job *steal(struct worker *thief, unsigned long long now) {
+    struct executor *ex = thief->ex;
+    int first = rand_r(&thief->seed) % ex->nb_workers;
+    for (int k = 0; k < ex->nb_workers; ++k) {
+        struct worker *victim = &ex->workers[(first + k) % ex->nb_workers];
+        if (victim == thief) {
+            continue;
+        }
+        struct job *job = NULL;
+        pthread_mutex_lock(&victim->lock);
+        release_due(victim, now);
+        if (victim->nb_ready) {
+            // The most urgent job: the victim is busy, so it is the one most likely to miss
+            job = victim->ready[--victim->nb_ready];
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (job) {
+            thief->steals++;
+            return job;
+        }
+    }
+    return NULL;
+}
+
+static void run_job(struct worker *w, struct job *job) {
+    unsigned long long start = now_ns();
+    job->fn(job->arg);
+    unsigned long long end = now_ns();
+    job_stats_t *stats = &job->stats;
+    long long lateness = (long long) end - (long long) absolute_deadline(job);
+    unsigned long long delay = start > job->release_ns ? start - job->release_ns : 0;
+    if (!stats->runs || lateness > stats->lateness_max_ns) {
+        stats->lateness_max_ns = lateness;
+    }
+    stats->lateness_sum_ns += lateness;
+    if (delay > stats->start_delay_max_ns) {
+        stats->start_delay_max_ns = delay;
+    }
+    if (lateness > 0) {
+        stats->misses++;
+    }
+    stats->runs++;
+    w->runs++;
+    // Periods whose deadline has already passed are not worth running
+    job->release_ns += job->period_ns;
+    while (absolute_deadline(job) <= end) {
+        job->release_ns += job->period_ns;
+        stats->skipped++;
+    }
+}
+
+static void *worker_main(void *arg) {
+    struct worker *w = arg;
+    struct executor *ex = w->ex;
+    while (__atomic_load_n(&ex->running, __ATOMIC_ACQUIRE)) {
+        unsigned long long now = now_ns();
+        pthread_mutex_lock(&w->lock);
+        release_due(w, now);
+        struct job *job = w->nb_ready ? w->ready[--w->nb_ready] : NULL;
+        unsigned long long next = w->nb_sleeping ? w->sleeping[0]->release_ns : ~0ULL;
+        pthread_mutex_unlock(&w->lock);
+        if (!job) {
+            job = steal(w, now);
+        }
+        if (!job) {
+            unsigned long long wake = now + EXECUTOR_IDLE_NS < next ? now + EXECUTOR_IDLE_NS : next;
+            struct timespec ts = { wake / 1000000000ULL, wake % 1000000000ULL };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            continue;
+        }
+        run_job(w, job);
+        pthread_mutex_lock(&w->lock);
+        heap_push(w, job);
+        pthread_mutex_unlock(&w->lock);
+    }
+    return NULL;
+}
+
+error_t executor_init(executor_t **ex, int workers) {
+    if (!ex) {
+        return NULL_PTR;
+    }
+    *ex = NULL;
+    if (workers < 1) {
+        return INVALID_ARGUMENT;
+    }
+    struct executor *e = calloc(1, sizeof(struct executor));
+    if (!e) {
+        return MALLOC;
+    }
+    e->workers = calloc(workers, sizeof(struct worker));
+    if (!e->workers) {
+        free(e);
+        return MALLOC;
+    }
+    int i;
+    for (i = 0; i < workers; ++i) {
+        if (pthread_mutex_init(&e->workers[i].lock, NULL)) {
+            break;
+        }
+        e->workers[i].ex = e;
+        e->workers[i].seed = i + 1;
+    }
+    if (i < workers) {
+        while (i-- > 0) {
+            pthread_mutex_destroy(&e->workers[i].lock);
+        }
+        free(e->workers);
+        free(e);
+        return MUTEX;
+    }
+    e->nb_workers = workers;
+    *ex = e;
+    return OK;
+}
+
+error_t executor_add(executor_t *ex, const char *name, job_fn fn, void *arg,
+                     unsigned long long first_release_ns, unsigned long long period_ns,
+                     unsigned long long deadline_ns) {
+    if (!ex || !name || !fn) {
+        return NULL_PTR;
+    }
+    if (ex->started || !period_ns) {
+        return INVALID_ARGUMENT;
+    }
+    if (ex->nb_jobs == ex->cap_jobs) {
+        int cap = ex->cap_jobs ? 2 * ex->cap_jobs : 64;
+        struct job *jobs = realloc(ex->jobs, cap * sizeof(struct job));
+        if (!jobs) {
+            return MALLOC;
+        }
+        ex->jobs = jobs;
+        ex->cap_jobs = cap;
+    }
+    struct job *job = &ex->jobs[ex->nb_jobs++];
+    memset(job, 0, sizeof(*job));
+    job->name = name;
+    job->fn = fn;
+    job->arg = arg;
+    job->release_ns = first_release_ns;
+    job->period_ns = period_ns;
+    job->deadline_ns = deadline_ns;
+    return OK;
+}
+
+error_t executor_start(executor_t *ex) {
+    if (!ex) {
+        return NULL_PTR;
+    }
+    if (ex->started) {
+        return INVALID_ARGUMENT;
+    }
+    // Any worker may end up holding every job, so each queue can hold them all
+    for (int i = 0; i < ex->nb_workers; ++i) {
+        struct worker *w = &ex->workers[i];
+        w->ready = malloc((ex->nb_jobs + 1) * sizeof(struct job *));
+        w->sleeping = malloc((ex->nb_jobs + 1) * sizeof(struct job *));
+        if (!w->ready || !w->sleeping) {
+            return MALLOC;
+        }
+    }
+    for (int j = 0; j < ex->nb_jobs; ++j) {
+        heap_push(&ex->workers[j % ex->nb_workers], &ex->jobs[j]);
+    }
+    ex->started = 1;
+    __atomic_store_n(&ex->running, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < ex->nb_workers; ++i) {
+        if (pthread_create(&ex->workers[i].thread, NULL, worker_main, &ex->workers[i])) {
+            __atomic_store_n(&ex->running, 0, __ATOMIC_RELEASE);
+            while (i-- > 0) {
+                pthread_join(ex->workers[i].thread, NULL);
+            }
+            ex->started = 0;
+            return MALLOC;
+        }
+    }
+    return OK;
+}
+
+error_t executor_stop(executor_t *ex) {
+    if (!ex) {
+        return NULL_PTR;
+    }
+    if (!__atomic_exchange_n(&ex->running, 0, __ATOMIC_ACQ_REL)) {
+        return OK;
+    }
+    for (int i = 0; i < ex->nb_workers; ++i) {
+        pthread_join(ex->workers[i].thread, NULL);
+    }
+    return OK;
+}
+
+void executor_report(executor_t *ex, FILE *out, int per_job) {
+    fprintf(out, "%-12s %6s %9s %8s %8s %14s %14s %14s\n", "job", "count", "runs", "misses",
+            "skipped", "late avg ms", "late max ms", "start max ms");
+    for (int j = 0; j < ex->nb_jobs; ++j) {
+        // One summary line per name, printed at its first occurrence
+        int first = 1;
+        for (int k = 0; k < j && first; ++k) {
+            first = strcmp(ex->jobs[k].name, ex->jobs[j].name) != 0;
+        }
+        if (!first) {
+            continue;
+        }
+        int count = 0;
+        job_stats_t total = {0};
+        for (int k = j; k < ex->nb_jobs; ++k) {
+            const job_stats_t *s = &ex->jobs[k].stats;
+            if (strcmp(ex->jobs[k].name, ex->jobs[j].name) || !s->runs) {
+                continue;
+            }
+            if (!count || s->lateness_max_ns > total.lateness_max_ns) {
+                total.lateness_max_ns = s->lateness_max_ns;
+            }
+            if (s->start_delay_max_ns > total.start_delay_max_ns) {
+                total.start_delay_max_ns = s->start_delay_max_ns;
+            }
+            total.runs += s->runs;
+            total.misses += s->misses;
+            total.skipped += s->skipped;
+            total.lateness_sum_ns += s->lateness_sum_ns;
+            count++;
+        }
+        fprintf(out, "%-12s %6d %9llu %8llu %8llu %14.2f %14.2f %14.2f\n", ex->jobs[j].name, count,
+                total.runs, total.misses, total.skipped,
+                total.runs ? total.lateness_sum_ns / 1e6 / total.runs : 0.0,
+                total.lateness_max_ns / 1e6, total.start_delay_max_ns / 1e6);
+    }
+    if (per_job) {
+        for (int j = 0; j < ex->nb_jobs; ++j) {
+            const job_stats_t *s = &ex->jobs[j].stats;
+            fprintf(out, "%-12s %6d %9llu %8llu %8llu %14.2f %14.2f %14.2f\n", ex->jobs[j].name, j,
+                    s->runs, s->misses, s->skipped,
+                    s->runs ? s->lateness_sum_ns / 1e6 / s->runs : 0.0,
+                    s->lateness_max_ns / 1e6, s->start_delay_max_ns / 1e6);
+        }
+    }
+    fprintf(out, "%-12s %9s %9s\n", "worker", "runs", "steals");
+    for (int i = 0; i < ex->nb_workers; ++i) {
+        fprintf(out, "%-12d %9llu %9llu\n", i, ex->workers[i].runs, ex->workers[i].steals);
+    }
+}
+
+error_t executor_free(executor_t *ex) {
+    if (!ex) {
+        return NULL_PTR;
+    }
+    executor_stop(ex);
+    error_t res = OK;
+    for (int i = 0; i < ex->nb_workers; ++i) {
+        if (pthread_mutex_destroy(&ex->workers[i].lock)) {
+            res = MUTEX;
+        }
+        free(ex->workers[i].ready);
+        free(ex->workers[i].sleeping);
+    }
+    free(ex->workers);
+    free(ex->jobs);
+    free(ex);
+    return res;
+}
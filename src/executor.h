@@ -0,0 +1,124 @@
+/**
+ * @file executor.h
+ * @brief Work-stealing executor for periodic patrol jobs of many coops.
+ *
+ * A fixed pool of worker threads runs periodic jobs (e.g., the sense and
+ * sound_alarm sequence of one coop). Each worker owns a deque of released
+ * jobs sorted by absolute deadline and runs the most urgent one first. Idle
+ * workers steal the most urgent job of another worker too: its owner is
+ * busy, so that job is the one whose deadline is the most at risk. A job is
+ * released again by the worker that ran it, so jobs migrate only when a
+ * worker runs out of work. The lateness of every job against its
+ * deadline is recorded.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+
+#include "chickens.h"
+
+
+// --- Types ---
+
+/**
+ * @typedef job_fn
+ * @brief Body of a job, called once per period with the argument given to executor_add.
+ */
+typedef void (*job_fn)(void *arg);
+
+/**
+ * @struct job_stats
+ * @brief Timing of a job. All times are in ns.
+ */
+struct job_stats {
+    /// Number of periods run
+    unsigned long long runs;
+    /// Number of periods completed after their deadline
+    unsigned long long misses;
+    /// Number of periods skipped because the job was already late for them
+    unsigned long long skipped;
+    /// Largest lateness (completion - absolute deadline, negative if always on time)
+    long long lateness_max_ns;
+    /// Sum of the lateness of all periods
+    long long lateness_sum_ns;
+    /// Largest delay between release and start
+    unsigned long long start_delay_max_ns;
+};
+
+/**
+ * @typedef job_stats_t
+ * @brief Typedef for the timing of a job.
+ * @see struct job_stats
+ */
+typedef struct job_stats job_stats_t;
+
+/**
+ * @typedef executor_t
+ * @brief The executor (Opaque structure).
+ */
+typedef struct executor executor_t;
+
+
+// --- Functions ---
+
+/**
+ * @brief Initializes an executor with the given number of workers.
+ *
+ * Must be freed with executor_free.
+ *
+ * @param ex Pointer to a pointer of type executor_t, which will be set.
+ * @param workers Number of worker threads (at least 1).
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t executor_init(executor_t **ex, int workers);
+
+/**
+ * @brief Adds a periodic job. Jobs can only be added before executor_start.
+ *
+ * @param ex Pointer to the executor.
+ * @param name Name used to group jobs in the report, must outlive the executor.
+ * @param fn Body of the job.
+ * @param arg Argument given to fn.
+ * @param first_release_ns CLOCK_MONOTONIC time (ns) of the first release.
+ * @param period_ns Period of the job (ns).
+ * @param deadline_ns Relative deadline of each period (ns).
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t executor_add(executor_t *ex, const char *name, job_fn fn, void *arg,
+                     unsigned long long first_release_ns, unsigned long long period_ns,
+                     unsigned long long deadline_ns);
+
+/**
+ * @brief Starts the workers. Jobs are spread over the workers round-robin.
+ *
+ * @param ex Pointer to the executor.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t executor_start(executor_t *ex);
+
+/**
+ * @brief Stops the workers once their current job is done, and joins them.
+ *
+ * @param ex Pointer to the executor.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t executor_stop(executor_t *ex);
+
+/**
+ * @brief Prints the lateness of the jobs, grouped by name, and the work of each worker.
+ *
+ * @param ex Pointer to the executor.
+ * @param out Stream to print to.
+ * @param per_job If non-zero, also prints one line per job.
+ */
+void executor_report(executor_t *ex, FILE *out, int per_job);
+
+/**
+ * @brief Frees the executor, stopping it first if needed.
+ *
+ * @param ex Pointer to the executor.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t executor_free(executor_t *ex);
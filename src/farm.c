@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "farm.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FARM_X86 1
+#endif
+
+// Arrays are padded with AWAY up to a whole number of 64-coop words
+#define FARM_ALIGN 64
+
+
+struct farm {
+    int coops;
+    int words;
+    enum farm_impl impl;
+    unsigned char *sides[NUM_THREATS];
+};
+
+static void detect_scalar(const unsigned char *sides, unsigned char side, uint64_t *mask, int words) {
+    for (int w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        for (int b = 0; b < 64; ++b) {
+            bits |= (uint64_t) (sides[w * 64 + b] == side) << b;
+        }
+        mask[w] = bits;
+    }
+}
+
+#ifdef FARM_X86
+__attribute__((target("sse2")))
+static void detect_sse2(const unsigned char *sides, unsigned char side, uint64_t *mask, int words) {
+    const __m128i needle = _mm_set1_epi8((char) side);
+    for (int w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        for (int b = 0; b < 4; ++b) {
+            __m128i v = _mm_load_si128((const __m128i *) (sides + w * 64 + b * 16));
+            bits |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)) << (b * 16);
+        }
+        mask[w] = bits;
+    }
+}
+
+__attribute__((target("avx2")))
+static void detect_avx2(const unsigned char *sides, unsigned char side, uint64_t *mask, int words) {
+    const __m256i needle = _mm256_set1_epi8((char) side);
+    for (int w = 0; w < words; ++w) {
+        __m256i lo = _mm256_load_si256((const __m256i *) (sides + w * 64));
+        __m256i hi = _mm256_load_si256((const __m256i *) (sides + w * 64 + 32));
+        uint32_t lo_bits = _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle));
+        uint32_t hi_bits = _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle));
+        mask[w] = (uint64_t) lo_bits | (uint64_t) hi_bits << 32;
+    }
+}
+#endif
+
+static int impl_supported(enum farm_impl impl) {
+    switch (impl) {
+        case FARM_SCALAR:
+            return 1;
+#ifdef FARM_X86
+        case FARM_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case FARM_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return 0;
+    }
+}
+
+error_t init_farm(farm_t **farm, int coops) {
+    if (!farm) {
+        return NULL_PTR;
+    }
+    *farm = NULL;
+    if (coops < 1) {
+        return INVALID_ARGUMENT;
+    }
+    struct farm *f = calloc(1, sizeof(struct farm));
+    if (!f) {
+        return MALLOC;
+    }
+    f->coops = coops;
+    f->words = (coops + 63) / 64;
+    for (int i = 0; i < NUM_THREATS; ++i) {
+        f->sides[i] = aligned_alloc(FARM_ALIGN, f->words * 64);
+        if (!f->sides[i]) {
+            while (i-- > 0) {
+                free(f->sides[i]);
+            }
+            free(f);
+            return MALLOC;
+        }
+        memset(f->sides[i], AWAY, f->words * 64);
+    }
+    farm_set_impl(f, FARM_AUTO);
+    *farm = f;
+    return OK;
+}
+
+error_t free_farm(farm_t *farm) {
+    if (!farm) {
+        return NULL_PTR;
+    }
+    for (int i = 0; i < NUM_THREATS; ++i) {
+        free(farm->sides[i]);
+    }
+    free(farm);
+    return OK;
+}
+
+error_t farm_attach(farm_t *farm, int index, sensors_t *sensors) {
+    if (!farm || !sensors) {
+        return NULL_PTR;
+    }
+    if (index < 0 || index >= farm->coops) {
+        return INVALID_ARGUMENT;
+    }
+    unsigned char *slots[NUM_THREATS];
+    for (int i = 0; i < NUM_THREATS; ++i) {
+        slots[i] = &farm->sides[i][index];
+    }
+    return mirror_sides(sensors, slots);
+}
+
+error_t farm_detach(farm_t *farm, int index, sensors_t *sensors) {
+    if (!farm || !sensors) {
+        return NULL_PTR;
+    }
+    if (index < 0 || index >= farm->coops) {
+        return INVALID_ARGUMENT;
+    }
+    error_t res = mirror_sides(sensors, NULL);
+    for (int i = 0; i < NUM_THREATS; ++i) {
+        __atomic_store_n(&farm->sides[i][index], AWAY, __ATOMIC_RELAXED);
+    }
+    return res;
+}
+
+error_t farm_set(farm_t *farm, int index, int threat, side_t side) {
+    if (!farm) {
+        return NULL_PTR;
+    }
+    if (index < 0 || index >= farm->coops || threat < 0 || threat >= NUM_THREATS) {
+        return INVALID_ARGUMENT;
+    }
+    if (side < AWAY || side > ABOVE) {
+        return INVALID_POSITION;
+    }
+    __atomic_store_n(&farm->sides[threat][index], (unsigned char) side, __ATOMIC_RELAXED);
+    return OK;
+}
+
+error_t farm_set_impl(farm_t *farm, enum farm_impl impl) {
+    if (!farm) {
+        return NULL_PTR;
+    }
+    if (impl == FARM_AUTO) {
+        impl = impl_supported(FARM_AVX2) ? FARM_AVX2 : impl_supported(FARM_SSE2) ? FARM_SSE2 : FARM_SCALAR;
+    }
+    if (!impl_supported(impl)) {
+        return INVALID_ARGUMENT;
+    }
+    farm->impl = impl;
+    return OK;
+}
+
+int farm_mask_words(const farm_t *farm) {
+    return farm ? farm->words : 0;
+}
+
+error_t farm_detect(const farm_t *farm, side_t side, uint64_t *mask, int *count) {
+    if (!farm || !mask) {
+        return NULL_PTR;
+    }
+    if (side < NORTH || side > ABOVE) {
+        return INVALID_POSITION;
+    }
+    const unsigned char *sides = farm->sides[side == ABOVE ? EAGLE_THREAT : FOX_THREAT];
+    switch (farm->impl) {
+#ifdef FARM_X86
+        case FARM_AVX2:
+            detect_avx2(sides, side, mask, farm->words);
+            break;
+        case FARM_SSE2:
+            detect_sse2(sides, side, mask, farm->words);
+            break;
+#endif
+        default:
+            detect_scalar(sides, side, mask, farm->words);
+            break;
+    }
+    if (count) {
+        *count = 0;
+        for (int w = 0; w < farm->words; ++w) {
+            *count += __builtin_popcountll(mask[w]);
+        }
+    }
+    return OK;
+}
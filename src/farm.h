@@ -0,0 +1,127 @@
+/**
+ * @file farm.h
+ * @brief Structure-of-arrays view of the threats of many coops, with batch detection.
+ *
+ * A farm keeps the side of the fox and of the eagle of every attached coop in
+ * two contiguous byte arrays, mirrored from the threats themselves. Detection
+ * for one side across the whole farm is then a few vector compares per 32 or
+ * 16 coops (AVX2 or SSE2, with a scalar fallback) and yields a bitmask of the
+ * coops that need an alarm. No sensor step is simulated: this is a farm-wide
+ * view to decide where the patrols must sound the alarm, not a replacement
+ * for sense.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include "chickens.h"
+
+
+// --- Types ---
+
+/**
+ * @enum farm_impl
+ * @brief Implementation of the batch compare.
+ */
+enum farm_impl {
+    /// The fastest one supported by the CPU
+    FARM_AUTO = 0,
+    /// One byte at a time
+    FARM_SCALAR = 1,
+    /// 16 coops per compare
+    FARM_SSE2 = 2,
+    /// 32 coops per compare
+    FARM_AVX2 = 3,
+};
+
+/**
+ * @typedef farm_t
+ * @brief Sides of the threats of many coops (Opaque structure).
+ */
+typedef struct farm farm_t;
+
+
+// --- Functions ---
+
+/**
+ * @brief Initializes a farm of the given number of coops, all threats AWAY.
+ *
+ * Must be freed with free_farm.
+ *
+ * @param farm Pointer to a pointer of type farm_t, which will be set.
+ * @param coops Number of coops.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t init_farm(farm_t **farm, int coops);
+
+/**
+ * @brief Frees the farm. Every attached sensors_t must be detached first.
+ *
+ * @param farm Pointer to the farm.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t free_farm(farm_t *farm);
+
+/**
+ * @brief Mirrors the threats of a sensors_t into the slot of a coop.
+ *
+ * @param farm Pointer to the farm.
+ * @param index Index of the coop in the farm.
+ * @param sensors The sensors_t whose threats hunt that coop.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t farm_attach(farm_t *farm, int index, sensors_t *sensors);
+
+/**
+ * @brief Stops mirroring the threats of a sensors_t. Its slot is set to AWAY.
+ *
+ * @param farm Pointer to the farm.
+ * @param index Index of the coop in the farm.
+ * @param sensors The sensors_t attached at that index.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t farm_detach(farm_t *farm, int index, sensors_t *sensors);
+
+/**
+ * @brief Sets the side of a threat of a coop directly (replay, tests, benchmarks).
+ *
+ * @param farm Pointer to the farm.
+ * @param index Index of the coop in the farm.
+ * @param threat Index of the threat (enum threat_index).
+ * @param side The side to store.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t farm_set(farm_t *farm, int index, int threat, side_t side);
+
+/**
+ * @brief Chooses the implementation of farm_detect.
+ *
+ * @param farm Pointer to the farm.
+ * @param impl The implementation, see enum farm_impl.
+ * @return error_t Returns INVALID_ARGUMENT if the CPU does not support it.
+ */
+error_t farm_set_impl(farm_t *farm, enum farm_impl impl);
+
+/**
+ * @brief Number of 64-bit words of a mask for this farm.
+ *
+ * @param farm Pointer to the farm.
+ * @return int The number of words, 0 if farm is NULL.
+ */
+int farm_mask_words(const farm_t *farm);
+
+/**
+ * @brief Finds every coop with a threat on the given side.
+ *
+ * Bit i of the mask (bit i % 64 of word i / 64) is set if the threat watching
+ * side in coop i is on that side.
+ *
+ * @param farm Pointer to the farm.
+ * @param side The side to look at (NORTH to ABOVE).
+ * @param mask Array of farm_mask_words words, which will be set.
+ * @param count Pointer to the number of coops found (can be NULL).
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t farm_detect(const farm_t *farm, side_t side, uint64_t *mask, int *count);
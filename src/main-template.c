@@ -1,6 +1,11 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "chickens.h"
+#include "telemetry.h"
+#include "task_stats.h"
+#include "admission.h"
+#include "overload.h"
+#include "scenario.h"
 #include <stdio.h>
 #include <pthread.h>
 #include <time.h>
@@ -8,6 +13,8 @@
 #include <signal.h>
 #include <semaphore.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sched.h>
 
 // Prototype de la fonction utilitaire d'affichage des directions
 const char* dir_name(side_t d);
@@ -16,6 +23,30 @@ const char* dir_name(side_t d);
 coop_t *c;
 sensors_t *sensors;
 
+// Statistiques temporelles et compteurs OS de chaque tâche (rapport en fin d'exécution)
+task_stats_t stats_renard, stats_aigle, stats_remplacement;
+
+// Contrôle d'admission des tâches périodiques (test d'ordonnançabilité en ligne)
+admission_t *admission;
+
+// Gestionnaire de surcharge : modes dégradés en cas d'échéances ratées
+overload_t *overload;
+
+// Scénario de menaces rejoué depuis un fichier (NULL : menaces aléatoires)
+scenario_t *scenario = NULL;
+
+// Nombre de périodes consécutives à l'heure pour redescendre d'un mode
+#define RECUPERATION_PERIODES 4
+
+// Période de surveillance de la fin de partie par le thread principal (ms)
+#define SURVEILLANCE_MS 100
+
+// Patrouille de l'aigle en cours (le renard lui cède la place en mode EAGLE_FIRST).
+// Le mutex est partagé par les patrouilles : créé dans main avec le protocole choisi.
+pthread_mutex_t mutex_aigle;
+pthread_cond_t cond_aigle;
+bool aigle_en_patrouille = false;
+
 // Sémaphore pour la tâche de remplacement (gestionnaire différé)
 sem_t sem_replacement;
 
@@ -31,20 +62,104 @@ void sigint_handler(int signum) {
     sem_post(&sem_replacement);
 }
 
-// Ajoute `ms` millisecondes au `timespec` fourni.
-void timespec_add_ms(struct timespec *ts, unsigned long ms) {
-    ts->tv_sec += ms / 1000;
-    ts->tv_nsec += (ms % 1000) * 1000000;
-    
-    // Normaliser si les nanosecondes dépassent 1 seconde
-    if (ts->tv_nsec >= 1000000000) {
-        ts->tv_sec += 1;
-        ts->tv_nsec -= 1000000000;
+// Avance de chaque patrouille sur l'attaque de sa menace, qui est aussi son échéance.
+// Aigle : WCET (2 pas) + 1 pas de marge. Renard : les attaques des deux menaces
+// coïncident toutes les FOX_TIME et l'aigle, plus prioritaire, peut le retarder de
+// tout son WCET, soit R = 4 pas ; + 1 pas de marge.
+#define AVANCE_RENARD (5*STEP_TIME)
+#define AVANCE_AIGLE (3*STEP_TIME)
+
+// WCET en pas et priorités fixes (rate monotonic : l'aigle a la plus courte période)
+#define PAS_RENARD 2
+#define PAS_AIGLE 2
+#define PRIORITE_RENARD 1
+#define PRIORITE_AIGLE 2
+
+// Demande l'admission d'une tâche périodique ; affiche la raison d'un refus.
+int admettre(const char *nom, unsigned long long periode_ms, unsigned long long echeance_ms,
+             unsigned int pas, int priorite, int *id) {
+    admission_verdict_t verdict;
+    error_t res = admission_register(admission, nom, periode_ms, echeance_ms, pas, priorite, id, &verdict);
+    if (res == REJECTED) {
+        fprintf(stderr, "[ADMISSION] %s refusée : %s (U = %.3f)\n", nom,
+                admission_reason_str(verdict.reason), verdict.utilization);
+    } else if (res != OK) {
+        fprintf(stderr, "[ADMISSION] Erreur lors de l'admission de %s (%d)\n", nom, res);
+    }
+    return res == OK;
+}
+
+// Calcule l'activation « juste à temps » d'une patrouille : `avance_ms` avant la
+// prochaine attaque de la menace qui surveille `side`. Si cet instant est déjà
+// passé (scan de cette attaque déjà fait), vise l'attaque suivante.
+void prochaine_activation(side_t side, unsigned long avance_ms, unsigned long periode_ms,
+                          struct timespec *activation) {
+    struct timespec expiry;
+    long long maintenant = now_ns();
+    long long periode_ns = periode_ms * 1000000LL;
+    long long cible_ns = maintenant + periode_ns;
+    if (get_next_expiry(sensors, side, &expiry) == OK && (expiry.tv_sec || expiry.tv_nsec)) {
+        cible_ns = expiry.tv_sec * 1000000000LL + expiry.tv_nsec - avance_ms * 1000000LL;
+        while (cible_ns <= maintenant) {
+            cible_ns += periode_ns;
+        }
+    }
+    activation->tv_sec = cible_ns / 1000000000LL;
+    activation->tv_nsec = cible_ns % 1000000000LL;
+}
+
+// Vrai une fois le scénario épuisé : aucune des deux menaces n'a plus d'événement armé.
+bool scenario_termine(void) {
+    struct timespec renard, aigle;
+    return get_next_expiry(sensors, NORTH, &renard) == OK && get_next_expiry(sensors, ABOVE, &aigle) == OK
+        && !renard.tv_sec && !renard.tv_nsec && !aigle.tv_sec && !aigle.tv_nsec;
+}
+
+// Réveille la tâche de remplacement, sauf si la surcharge l'a suspendue.
+void liberer_remplacement(void) {
+    if (overload_mode(overload) < OVERLOAD_DROP_REPLACEMENT) {
+        sem_post(&sem_replacement);
+    }
+}
+
+// Crée la condition de fin de patrouille de l'aigle sur CLOCK_MONOTONIC, l'horloge
+// des activations dont le renard tire sa limite d'attente.
+int init_cond_aigle(void) {
+    pthread_condattr_t attr;
+    if (pthread_condattr_init(&attr) != 0) {
+        return 0;
     }
+    int ok = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) == 0
+          && pthread_cond_init(&cond_aigle, &attr) == 0;
+    pthread_condattr_destroy(&attr);
+    return ok;
+}
+
+// Marque le début ou la fin d'une patrouille de l'aigle.
+void patrouille_aigle(bool en_cours) {
+    pthread_mutex_lock(&mutex_aigle);
+    aigle_en_patrouille = en_cours;
+    if (!en_cours) {
+        pthread_cond_broadcast(&cond_aigle);
+    }
+    pthread_mutex_unlock(&mutex_aigle);
+}
+
+// En mode EAGLE_FIRST, le renard attend la fin de la patrouille de l'aigle,
+// au plus jusqu'à `limite` pour garder le temps de son propre scan.
+void ceder_a_l_aigle(const struct timespec *limite) {
+    pthread_mutex_lock(&mutex_aigle);
+    while (aigle_en_patrouille && !should_stop) {
+        if (pthread_cond_timedwait(&cond_aigle, &mutex_aigle, limite) != 0) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mutex_aigle);
 }
 
 // Tâche de remplacement : débloquée par sémaphore pour restaurer les poules perdues.
 void* tache_remplacement(void* arg) {
+    task_stats_attach(&stats_remplacement);
     while (1) {
         // Attendre d'être libéré par une autre tâche
         sem_wait(&sem_replacement);
@@ -55,6 +170,9 @@ void* tache_remplacement(void* arg) {
             break;
         }
         
+        // Tâche apériodique : sa « libération » est son réveil
+        task_stats_begin(&stats_remplacement, NULL);
+        
         // Vérifier combien de poules restent
         int chickens_count;
         error_t res = get_chickens(c, &chickens_count);
@@ -69,6 +187,7 @@ void* tache_remplacement(void* arg) {
                 fprintf(stderr, "[REMPLACEMENT] Erreur lors de l'ajout d'une poule\n");
             }
         }
+        task_stats_end(&stats_remplacement);
     }
     
     return NULL;
@@ -77,36 +196,57 @@ void* tache_remplacement(void* arg) {
 // Tâche renard : patrouille périodique sur les côtés NORTH, SOUTH, EAST.
 void* tache_renard(void* arg) {
     struct timespec next_activation;
-    clock_gettime(CLOCK_MONOTONIC, &next_activation);
+    task_stats_attach(&stats_renard);
     
     // Côtés actifs à surveiller (WEST est mur, AWAY = aucun vol)
     side_t directions_renard[] = {NORTH, SOUTH, EAST};
     int nb_directions = 3;
     
     while (!should_stop) {
+        // Se caler sur la phase du renard : scanner juste avant sa prochaine attaque
+        prochaine_activation(NORTH, AVANCE_RENARD, FOX_TIME, &next_activation);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_activation, NULL);
+        if (should_stop) {
+            break;
+        }
+        task_stats_begin(&stats_renard, &next_activation);
+        enum overload_mode mode = overload_mode(overload);
+        if (mode >= OVERLOAD_EAGLE_FIRST) {
+            // Attendre l'aigle au plus un pas : la marge entre l'avance et le WCET
+            struct timespec limite = next_activation;
+            limite.tv_sec += STEP_TIME / 1000;
+            limite.tv_nsec += (STEP_TIME % 1000) * 1000000L;
+            if (limite.tv_nsec >= 1000000000L) {
+                limite.tv_sec++;
+                limite.tv_nsec -= 1000000000L;
+            }
+            ceder_a_l_aigle(&limite);
+        }
+        // Retard de libération de la patrouille, pour l'attribution des vols
+        record_patrol_release(sensors, directions_renard, nb_directions, &next_activation);
         printf("[RENARD] Patrouille période FOX_TIME: scan des côtés actifs\n");
         bool menace_trouvee = false;
-        for (int i = 0; i < nb_directions && !should_stop; ++i) {
+        // Un seul appel multi-côtés : avec une tête par côté, le scan prend un seul pas
+        sense_t resultats[3];
+        error_t sense_error = sense_multi(sensors, directions_renard, nb_directions, resultats);
+        if (sense_error != OK) {
+            printf("[RENARD] Erreur sense_multi (%d)\n", sense_error);
+        }
+        for (int i = 0; i < nb_directions && sense_error == OK && !should_stop; ++i) {
             side_t side = directions_renard[i];
-            error_t sense_error = OK;
-            sense_t result = sense(sensors, side, &sense_error);
-            if (sense_error == OK && result == DETECTED) {
+            if (resultats[i] == DETECTED) {
                 printf("[RENARD] Menace DETECTED sur %s -> Alarme avant fin période\n", dir_name(side));
                 sound_alarm(sensors, side);
                 menace_trouvee = true;
                 break; // Menace neutralisée pour cette période
-            } else if (sense_error != OK) {
-                printf("[RENARD] Erreur sense (%d) sur %s\n", sense_error, dir_name(side));
             }
         }
         if (!menace_trouvee) {
-            printf("[RENARD] Aucune menace détectée sur N/S/E cette période -> temps libre\n");
-            sem_post(&sem_replacement); // Une seule libération
+            printf("[RENARD] Aucune menace détectée cette période -> temps libre\n");
+            liberer_remplacement(); // Une seule libération
         }
-        
-        // Attendre la prochaine période (FOX_TIME = 4000ms)
-        timespec_add_ms(&next_activation, FOX_TIME);
-        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_activation, NULL);
+        int manquee = task_stats_end(&stats_renard);
+        overload_period(overload, "RENARD", manquee, stats_renard.last_lateness_ns);
     }
     
     printf("[RENARD] Arrêt de la tâche\n");
@@ -116,8 +256,17 @@ void* tache_renard(void* arg) {
 // Tâche aigle : unique côté ABOVE à surveiller chaque période EAGLE_TIME.
 void* tache_aigle(void* arg) {
     struct timespec next_activation;
-    clock_gettime(CLOCK_MONOTONIC, &next_activation);
+    task_stats_attach(&stats_aigle);
     while (!should_stop) {
+        prochaine_activation(ABOVE, AVANCE_AIGLE, EAGLE_TIME, &next_activation);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_activation, NULL);
+        if (should_stop) {
+            break;
+        }
+        task_stats_begin(&stats_aigle, &next_activation);
+        side_t cote_aigle = ABOVE;
+        record_patrol_release(sensors, &cote_aigle, 1, &next_activation);
+        patrouille_aigle(true);
         printf("[AIGLE] Patrouille ABOVE période EAGLE_TIME\n");
         error_t sense_error = OK;
         sense_t result = sense(sensors, ABOVE, &sense_error);
@@ -126,20 +275,64 @@ void* tache_aigle(void* arg) {
             sound_alarm(sensors, ABOVE);
         } else if (sense_error == OK && result == NORMAL) {
             printf("[AIGLE] Rien ABOVE cette période -> temps libre\n");
-            sem_post(&sem_replacement);
+            liberer_remplacement();
         } else {
             printf("[AIGLE] Erreur sense (%d) ABOVE\n", sense_error);
         }
-        timespec_add_ms(&next_activation, EAGLE_TIME);
-        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_activation, NULL);
+        patrouille_aigle(false);
+        int manquee = task_stats_end(&stats_aigle);
+        overload_period(overload, "AIGLE", manquee, stats_aigle.last_lateness_ns);
     }
     printf("[AIGLE] Arrêt de la tâche\n");
     return NULL;
 }
 
 
+// Plafond SCHED_FIFO des mutex en mode « protect » (au-dessus de toutes les tâches)
+#define PLAFOND_VERROUS 10
+// Priorité SCHED_FIFO du processus en mode « protect », sous le plafond
+#define PRIORITE_TEMPS_REEL 1
+
+// Blocage mesuré le plus long (ms, arrondi au-dessus) sur les mutex du système.
+// Il est pris comme terme B de chaque tâche : c'est une borne pessimiste, qui
+// compte aussi l'attente derrière des tâches plus prioritaires.
+unsigned long long blocage_mesure_ms(void) {
+    unsigned long long max_ns = 0;
+    for (int kind = 0; kind < LOCK_KINDS; ++kind) {
+        lock_stats_t ls;
+        if (get_lock_stats(sensors, c, kind, &ls) == OK && ls.blocked_max_ns > max_ns) {
+            max_ns = ls.blocked_max_ns;
+        }
+    }
+    return (max_ns + 999999) / 1000000;
+}
+
 int main(int argc, char *argv[]) {
     printf("=== Système de protection de poules ===\n");
+    
+    // Protocole des mutex : héritage de priorité par défaut (pas d'inversion non bornée)
+    enum lock_protocol protocole = LOCK_PRIO_INHERIT;
+    if (argc > 1 && !strcmp(argv[1], "none")) {
+        protocole = LOCK_PRIO_NONE;
+    } else if (argc > 1 && !strcmp(argv[1], "protect")) {
+        protocole = LOCK_PRIO_PROTECT;
+    } else if (argc > 1 && strcmp(argv[1], "inherit")) {
+        fprintf(stderr, "Usage : %s [none|inherit|protect] [scénario]\n", argv[0]);
+        return 1;
+    }
+    if (set_lock_protocol(protocole, PLAFOND_VERROUS) != OK) {
+        fprintf(stderr, "Protocole de mutex invalide\n");
+        return 1;
+    }
+    // Le plafond ne s'applique qu'aux threads SCHED_FIFO/RR : on y passe avant de créer
+    // quoi que ce soit, pour que les tâches et les threads des timers en héritent.
+    if (protocole == LOCK_PRIO_PROTECT) {
+        struct sched_param param = {.sched_priority = PRIORITE_TEMPS_REEL};
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+            fprintf(stderr, "SCHED_FIFO refusé (droits temps réel requis pour « protect »)\n");
+            return 1;
+        }
+    }
 
     // Initialiser RNG pour choix du renard
     srand((unsigned)time(NULL));
@@ -150,6 +343,11 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    // Échéance des patrouilles : l'attaque de la menace, AVANCE ms après leur réveil
+    task_stats_init(&stats_renard, "RENARD", AVANCE_RENARD);
+    task_stats_init(&stats_aigle, "AIGLE", AVANCE_AIGLE);
+    task_stats_init(&stats_remplacement, "REMPLACEMENT", 0);
+    
     // Installer le gestionnaire de signal SIGINT
     struct sigaction sa;
     sa.sa_handler = sigint_handler;
@@ -161,22 +359,68 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    // Publication de l'état dans le segment partagé (lu par telemetry-reader)
+    if (telemetry_open(TELEMETRY_NAME) != OK) {
+        fprintf(stderr, "Télémétrie indisponible, poursuite sans publication\n");
+    }
+    
     // Initialisation du poulailler et des capteurs
     error_t res = init_coop(&c);
     if (res != OK) {
         fprintf(stderr, "Erreur lors de l'initialisation du poulailler\n");
         sem_destroy(&sem_replacement);
+        telemetry_close();
         return 1;
     }
+    // Pas d'exit au dernier vol : la partie se termine dans main, qui affiche les rapports
+    set_coop_mode(c, COOP_NO_EXIT);
     
-    res = init_sensors(&sensors);
+    // Une tête de capteur par côté : renard et aigle ne se bloquent plus mutuellement
+    res = init_sensors_heads(&sensors, MAX_SENSOR_HEADS);
     if (res != OK) {
         fprintf(stderr, "Erreur lors de l'initialisation des capteurs\n");
         free_coop(c);
         sem_destroy(&sem_replacement);
+        telemetry_close();
         return 1;
     }
     
+    // Admission des patrouilles : on ne démarre que si l'ensemble de tâches est ordonnançable
+    int id_renard, id_aigle;
+    if (init_admission(&admission, 8, STEP_TIME) != OK
+        || !admettre("RENARD", FOX_TIME, AVANCE_RENARD, PAS_RENARD, PRIORITE_RENARD, &id_renard)
+        || !admettre("AIGLE", EAGLE_TIME, AVANCE_AIGLE, PAS_AIGLE, PRIORITE_AIGLE, &id_aigle)) {
+        fprintf(stderr, "Ensemble de tâches non ordonnançable, arrêt\n");
+        free_admission(admission);
+        free_sensors(sensors);
+        free_coop(c);
+        sem_destroy(&sem_replacement);
+        telemetry_close();
+        return 1;
+    }
+    admission_report(admission, stdout);
+    
+    // Les transitions de mode sont journalisées sur la sortie standard
+    if (init_overload(&overload, RECUPERATION_PERIODES, stdout) != OK) {
+        fprintf(stderr, "Gestionnaire de surcharge indisponible, poursuite sans modes dégradés\n");
+    }
+    
+    // Menaces scriptées : le fichier est projeté en mémoire et lu au fil de l'eau
+    if (argc > 2) {
+        if (scenario_open(&scenario, argv[2]) != OK || scenario_play(scenario, sensors) != OK) {
+            fprintf(stderr, "Scénario %s illisible\n", argv[2]);
+            scenario_close(scenario);
+            free_admission(admission);
+            free_overload(overload);
+            free_sensors(sensors);
+            free_coop(c);
+            sem_destroy(&sem_replacement);
+            telemetry_close();
+            return 1;
+        }
+        printf("Rejeu du scénario %s\n", argv[2]);
+    }
+    
     // Démarrage des timers du renard et de l'aigle
     start_hunt(sensors, c);
     
@@ -193,12 +437,29 @@ int main(int argc, char *argv[]) {
     // Création des threads pour les trois tâches
     pthread_t thread_renard, thread_aigle, thread_remplacement;
     
+    if (init_mutex(&mutex_aigle, NULL) != OK || !init_cond_aigle()) {
+        fprintf(stderr, "Erreur lors de l'initialisation du mutex de l'aigle\n");
+        stop_hunt(sensors);
+        free_admission(admission);
+        free_overload(overload);
+        scenario_close(scenario);
+        free_sensors(sensors);
+        free_coop(c);
+        sem_destroy(&sem_replacement);
+        telemetry_close();
+        return 1;
+    }
+    
     if (pthread_create(&thread_remplacement, NULL, tache_remplacement, NULL) != 0) {
         fprintf(stderr, "Erreur lors de la création du thread de remplacement\n");
         stop_hunt(sensors);
+        free_admission(admission);
+        free_overload(overload);
+        scenario_close(scenario);
         free_sensors(sensors);
         free_coop(c);
         sem_destroy(&sem_replacement);
+        telemetry_close();
         return 1;
     }
     
@@ -208,9 +469,13 @@ int main(int argc, char *argv[]) {
         sem_post(&sem_replacement);
         pthread_join(thread_remplacement, NULL);
         stop_hunt(sensors);
+        free_admission(admission);
+        free_overload(overload);
+        scenario_close(scenario);
         free_sensors(sensors);
         free_coop(c);
         sem_destroy(&sem_replacement);
+        telemetry_close();
         return 1;
     }
     
@@ -222,23 +487,81 @@ int main(int argc, char *argv[]) {
         pthread_join(thread_renard, NULL);
         pthread_join(thread_remplacement, NULL);
         stop_hunt(sensors);
+        free_admission(admission);
+        free_overload(overload);
+        scenario_close(scenario);
         free_sensors(sensors);
         free_coop(c);
         sem_destroy(&sem_replacement);
+        telemetry_close();
         return 1;
     }
     
-    // Attendre la fin des threads (lors de SIGINT ou fin du jeu)
+    // Fin de partie : SIGINT, plus de poules, ou scénario épuisé
+    struct timespec surveillance = {0, SURVEILLANCE_MS * 1000000L};
+    while (!should_stop) {
+        if (get_chickens(c, &chickens) == OK && chickens == 0) {
+            printf("\n[MAIN] Plus aucune poule, fin de la partie\n");
+            break;
+        }
+        if (scenario && scenario_termine()) {
+            printf("\n[MAIN] Scénario épuisé, fin du rejeu\n");
+            break;
+        }
+        nanosleep(&surveillance, NULL);
+    }
+    should_stop = 1;
+    sem_post(&sem_replacement);
+
+    // Attendre la fin des threads (chacun au plus jusqu'à sa prochaine activation)
     pthread_join(thread_renard, NULL);
     pthread_join(thread_aigle, NULL);
     pthread_join(thread_remplacement, NULL);
     
+    // Rapport des temps de réponse et des compteurs OS par tâche
+    printf("\n[MAIN] Statistiques des tâches :\n");
+    task_stats_t *const all_stats[] = {&stats_renard, &stats_aigle, &stats_remplacement};
+    task_stats_report(stdout, all_stats, 3);
+    for (int i = 0; i < 3; ++i) {
+        task_stats_close(all_stats[i]);
+    }
+    printf("\n[MAIN] Modes de surcharge :\n");
+    overload_report(overload, stdout);
+    if (scenario) {
+        printf("\n[MAIN] Scénario :\n");
+        scenario_report(scenario, stdout);
+    }
+    printf("\n[MAIN] Causes des vols :\n");
+    steal_report(sensors, stdout);
+    printf("\n[MAIN] Temps de blocage des mutex :\n");
+    lock_report(sensors, c, stdout);
+    
+    // Analyse du temps de réponse avec le terme de blocage mesuré au lieu d'un B supposé nul
+    unsigned long long blocage = blocage_mesure_ms();
+    admission_verdict_t verdict_renard = {0}, verdict_aigle = {0};
+    admission_set_blocking(admission, id_renard, blocage, &verdict_renard);
+    admission_set_blocking(admission, id_aigle, blocage, &verdict_aigle);
+    printf("\n[MAIN] Ordonnançabilité avec B = %llu ms :\n", blocage);
+    printf("RENARD : %s\n", admission_reason_str(verdict_renard.reason));
+    printf("AIGLE  : %s\n", admission_reason_str(verdict_aigle.reason));
+    admission_report(admission, stdout);
+    
     // Nettoyage des ressources
     printf("\n[MAIN] Nettoyage des ressources...\n");
     stop_hunt(sensors);
+    admission_unregister(admission, id_aigle);
+    admission_unregister(admission, id_renard);
+    free_admission(admission);
+    free_overload(overload);
+    if (scenario) {
+        scenario_close(scenario);
+    }
     free_sensors(sensors);
     free_coop(c);
+    pthread_cond_destroy(&cond_aigle);
+    pthread_mutex_destroy(&mutex_aigle);
     sem_destroy(&sem_replacement);
+    telemetry_close();
     
     printf("[MAIN] Programme terminé proprement.\n");
     return 0;
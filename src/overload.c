@@ -0,0 +1,135 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "overload.h"
+
+
+struct overload {
+    pthread_mutex_t lock;
+    enum overload_mode mode;
+    unsigned int recovery;
+    /// Consecutive periods on time since the last miss or transition
+    unsigned int on_time;
+    FILE *log;
+    unsigned long long start_ns;
+    unsigned long long entered_ns;
+    unsigned long long transitions;
+    unsigned long long misses;
+    unsigned long long time_in_ns[OVERLOAD_MODES];
+};
+
+/*
+ * Moves to a new mode and logs why. Called with the lock held.
+ */
+static void switch_mode(struct overload *ov, enum overload_mode mode, const char *task,
+                        long long lateness_ns) {
+    unsigned long long now = now_ns();
+    ov->time_in_ns[ov->mode] += now - ov->entered_ns;
+    ov->entered_ns = now;
+    ov->transitions++;
+    ov->on_time = 0;
+    if (ov->log) {
+        if (mode > ov->mode) {
+            fprintf(ov->log, "[OVERLOAD] t=%.3f s %s -> %s: %s missed its deadline by %.2f ms\n",
+                    (now - ov->start_ns) / 1e9, overload_mode_str(ov->mode), overload_mode_str(mode),
+                    task, lateness_ns / 1e6);
+        } else {
+            fprintf(ov->log, "[OVERLOAD] t=%.3f s %s -> %s: %u periods on time\n",
+                    (now - ov->start_ns) / 1e9, overload_mode_str(ov->mode), overload_mode_str(mode),
+                    ov->recovery);
+        }
+        fflush(ov->log);
+    }
+    __atomic_store_n(&ov->mode, mode, __ATOMIC_RELEASE);
+}
+
+error_t init_overload(overload_t **ov, unsigned int recovery, FILE *log) {
+    if (!ov) {
+        return NULL_PTR;
+    }
+    *ov = NULL;
+    if (recovery < 1) {
+        return INVALID_ARGUMENT;
+    }
+    struct overload *o = calloc(1, sizeof(struct overload));
+    if (!o) {
+        return MALLOC;
+    }
+    if (pthread_mutex_init(&o->lock, NULL)) {
+        free(o);
+        return MUTEX;
+    }
+    o->mode = OVERLOAD_NORMAL;
+    o->recovery = recovery;
+    o->log = log;
+    o->start_ns = now_ns();
+    o->entered_ns = o->start_ns;
+    *ov = o;
+    return OK;
+}
+
+error_t free_overload(overload_t *ov) {
+    if (!ov) {
+        return NULL_PTR;
+    }
+    error_t res = OK;
+    if (pthread_mutex_destroy(&ov->lock)) {
+        res = MUTEX;
+    }
+    free(ov);
+    return res;
+}
+
+enum overload_mode overload_period(overload_t *ov, const char *task, int missed, long long lateness_ns) {
+    if (!ov || pthread_mutex_lock(&ov->lock)) {
+        return overload_mode(ov);
+    }
+    if (missed) {
+        ov->misses++;
+        ov->on_time = 0;
+        if (ov->mode + 1 < OVERLOAD_MODES) {
+            switch_mode(ov, ov->mode + 1, task, lateness_ns);
+        }
+    } else if (ov->mode != OVERLOAD_NORMAL && ++ov->on_time >= ov->recovery) {
+        switch_mode(ov, ov->mode - 1, task, lateness_ns);
+    }
+    enum overload_mode mode = ov->mode;
+    pthread_mutex_unlock(&ov->lock);
+    return mode;
+}
+
+enum overload_mode overload_mode(const overload_t *ov) {
+    if (!ov) {
+        return OVERLOAD_NORMAL;
+    }
+    return __atomic_load_n(&ov->mode, __ATOMIC_ACQUIRE);
+}
+
+const char *overload_mode_str(enum overload_mode mode) {
+    switch (mode) {
+        case OVERLOAD_NORMAL: return "NORMAL";
+        case OVERLOAD_DROP_REPLACEMENT: return "DROP_REPLACEMENT";
+        case OVERLOAD_EAGLE_FIRST: return "EAGLE_FIRST";
+        default: return "UNKNOWN";
+    }
+}
+
+void overload_report(overload_t *ov, FILE *out) {
+    if (!ov || !out || pthread_mutex_lock(&ov->lock)) {
+        return;
+    }
+    unsigned long long now = now_ns();
+    unsigned long long total = now - ov->start_ns;
+    fprintf(out, "mode %s, %llu misses, %llu transitions\n", overload_mode_str(ov->mode), ov->misses,
+            ov->transitions);
+    fprintf(out, "%-18s %12s %7s\n", "mode", "time s", "share");
+    for (int m = 0; m < OVERLOAD_MODES; ++m) {
+        unsigned long long t = ov->time_in_ns[m] + (m == (int) ov->mode ? now - ov->entered_ns : 0);
+        fprintf(out, "%-18s %12.3f %6.1f%%\n", overload_mode_str(m), t / 1e9,
+                total ? 100.0 * t / total : 0.0);
+    }
+    pthread_mutex_unlock(&ov->lock);
+}
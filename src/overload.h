@@ -0,0 +1,111 @@
+/**
+ * @file overload.h
+ * @brief Overload manager switching the patrols to degraded modes on deadline misses.
+ *
+ * The patrol tasks report every period with its outcome. A missed deadline
+ * moves the manager one mode up, each mode keeping the degradations of the
+ * lower ones; a run of periods completed on time moves it one mode down, back
+ * to normal once timing has recovered. Every transition is logged with its
+ * cause. The manager only decides the mode: the tasks read it and apply the
+ * degradation themselves.
+ *
+ * Three levels are enough for the patrols: with one head per side, the fox
+ * senses its three sides in a single step, so scanning fewer sides would
+ * neither shorten its WCET nor free the CPU, and skipping the alarm would
+ * leave a detected threat free to steal. Past EAGLE_FIRST, the only lever
+ * left is the admission of the task set (see admission.h).
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+
+#include "chickens.h"
+
+
+// --- Enumerations ---
+
+/**
+ * @enum overload_mode
+ * @brief Operating modes, from normal to the most degraded.
+ */
+enum overload_mode {
+    /// Every task runs as designed
+    OVERLOAD_NORMAL = 0,
+    /// The replacement task is no longer woken up
+    OVERLOAD_DROP_REPLACEMENT = 1,
+    /// Also, the fox patrol waits (at most one step) for the eagle patrol to
+    /// finish before scanning. The fox and the eagle use different heads, so
+    /// this removes no lock contention: it only helps when the misses come
+    /// from a saturated CPU, by letting the more urgent eagle run alone.
+    OVERLOAD_EAGLE_FIRST = 2,
+    /// Number of modes
+    OVERLOAD_MODES = 3,
+};
+
+/**
+ * @typedef overload_t
+ * @brief The overload manager (Opaque structure).
+ */
+typedef struct overload overload_t;
+
+
+// --- Functions ---
+
+/**
+ * @brief Initializes an overload manager in normal mode.
+ *
+ * Must be freed with free_overload.
+ *
+ * @param ov Pointer to a pointer of type overload_t, which will be set.
+ * @param recovery Number of consecutive periods on time needed to go one mode down (at least 1).
+ * @param log Stream where transitions are logged (can be NULL).
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t init_overload(overload_t **ov, unsigned int recovery, FILE *log);
+
+/**
+ * @brief Frees the overload manager.
+ *
+ * @param ov Pointer to the overload manager.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t free_overload(overload_t *ov);
+
+/**
+ * @brief Reports the outcome of one period of a task and updates the mode.
+ *
+ * Thread-safe. Typically called with the result of task_stats_end.
+ *
+ * @param ov Pointer to the overload manager.
+ * @param task Name of the task, used in the log.
+ * @param missed Non-zero if the period missed its deadline.
+ * @param lateness_ns Completion time minus deadline (negative if on time).
+ * @return enum overload_mode The mode after the update.
+ */
+enum overload_mode overload_period(overload_t *ov, const char *task, int missed, long long lateness_ns);
+
+/**
+ * @brief Gives the current mode. Lock-free, meant to be called at each period.
+ *
+ * @param ov Pointer to the overload manager.
+ * @return enum overload_mode The current mode, OVERLOAD_NORMAL if ov is NULL.
+ */
+enum overload_mode overload_mode(const overload_t *ov);
+
+/**
+ * @brief Gives the name of a mode.
+ *
+ * @param mode The mode.
+ * @return const char* A static string.
+ */
+const char *overload_mode_str(enum overload_mode mode);
+
+/**
+ * @brief Prints the number of transitions and the time spent in each mode.
+ *
+ * @param ov Pointer to the overload manager.
+ * @param out Stream to print to.
+ */
+void overload_report(overload_t *ov, FILE *out);
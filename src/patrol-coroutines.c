@@ -0,0 +1,320 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "chickens.h"
+#include "coroutine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+
+// Patrouilles coopératives : les tâches renard, aigle et remplacement de
+// chaque poulailler sont des coroutines sans pile multiplexées sur un seul
+// thread OS. Les pas de capteur (step_begin / sense_end / alarm_end)
+// s'écoulent sans occuper le CPU, ce qui permet à un seul cœur de patrouiller
+// des milliers de poulaillers.
+//
+// Usage : patrol-coroutines [poulaillers] [secondes] [facteur]
+//   poulaillers  nombre de poulaillers (défaut 1000)
+//   secondes     durée de la simulation (défaut 20)
+//   facteur      accélération du temps, voir set_time_scale (défaut 1)
+
+// Délai avant de réessayer une tête de capteur occupée
+#define POLL_NS 1000000ULL
+// Attente maximale du planificateur, pour vérifier régulièrement should_stop
+#define MAX_IDLE_NS 100000000ULL
+#define NEVER (~0ULL)
+
+volatile sig_atomic_t should_stop = 0;
+
+void sigint_handler(int signum) {
+    should_stop = 1;
+}
+
+// Périodes et avances (WCET + 1 pas de marge), mises à l'échelle dans main
+unsigned long long periode_renard, periode_aigle, avance;
+
+// Statistiques globales : un seul thread, pas besoin de mutex
+unsigned long long scans, alarmes, echeances_manquees, retard_max;
+
+typedef struct {
+    coop_t *coop;
+    sensors_t *sensors;
+    // Libérations en attente pour la tâche de remplacement (remplace le sémaphore)
+    int a_remplacer;
+    co_t *remplacement;
+} cell_t;
+
+// État des tâches : tout ce qui doit survivre à une attente est ici
+typedef struct {
+    co_t co;
+    cell_t *cell;
+    unsigned long long activation;
+    int i, lances, detecte;
+    error_t err;
+    step_t steps[3];
+    step_t alarme;
+} renard_t;
+
+typedef struct {
+    co_t co;
+    cell_t *cell;
+    unsigned long long activation;
+    error_t err;
+    step_t step;
+    step_t alarme;
+} aigle_t;
+
+typedef struct {
+    co_t co;
+    cell_t *cell;
+} remplacement_t;
+
+// Une entrée du planificateur : chaque état de tâche commence par son co_t
+typedef struct {
+    co_t *co;
+    int (*run)(void *);
+    int fini;
+} tache_t;
+
+const side_t cotes_renard[3] = {NORTH, SOUTH, EAST};
+
+// Réveil « juste à temps » : `avance` avant la prochaine attaque de la menace
+unsigned long long activation(sensors_t *sensors, side_t side, unsigned long long periode) {
+    struct timespec expiry;
+    unsigned long long now = now_ns();
+    unsigned long long cible = now + periode;
+    if (get_next_expiry(sensors, side, &expiry) == OK && (expiry.tv_sec || expiry.tv_nsec)) {
+        cible = expiry.tv_sec * 1000000000ULL + expiry.tv_nsec - avance;
+        while (cible <= now) {
+            cible += periode;
+        }
+    }
+    return cible;
+}
+
+void fin_de_scan(unsigned long long activation) {
+    unsigned long long fin = now_ns();
+    if (fin > activation + avance) {
+        echeances_manquees++;
+        if (fin - activation - avance > retard_max) {
+            retard_max = fin - activation - avance;
+        }
+    }
+}
+
+void liberer_remplacement(cell_t *cell) {
+    cell->a_remplacer++;
+    cell->remplacement->wake_ns = 0;
+}
+
+int renard(void *arg) {
+    renard_t *t = arg;
+    CO_BEGIN(&t->co);
+    while (!should_stop) {
+        t->activation = activation(t->cell->sensors, NORTH, periode_renard);
+        CO_WAIT_UNTIL(&t->co, should_stop || now_ns() >= t->activation, t->activation);
+        if (should_stop) {
+            break;
+        }
+        // Les trois côtés sont servis par trois têtes distinctes : les pas se recouvrent.
+        // Une tête occupée (WOULD_BLOCK) est réessayée, toute autre erreur arrête la patrouille.
+        for (t->i = 0; t->i < 3; ++t->i) {
+            CO_WAIT_UNTIL(&t->co, (t->err = step_begin(t->cell->sensors, cotes_renard[t->i],
+                                                       &t->steps[t->i])) != WOULD_BLOCK,
+                          now_ns() + POLL_NS);
+            if (t->err != OK) {
+                break;
+            }
+        }
+        // Les pas déjà commencés doivent être terminés pour libérer leurs têtes
+        for (t->lances = t->i, t->i = 0; t->i < t->lances; ++t->i) {
+            CO_WAIT_UNTIL(&t->co, step_done(&t->steps[t->i]), t->steps[t->i].end_ns);
+        }
+        t->detecte = -1;
+        for (int i = 0; i < t->lances; ++i) {
+            if (sense_end(&t->steps[i], NULL) == DETECTED) {
+                t->detecte = i;
+            }
+        }
+        if (t->err != OK) {
+            fprintf(stderr, "[RENARD] Erreur %d de step_begin, arrêt de la patrouille\n", t->err);
+            break;
+        }
+        scans++;
+        if (t->detecte >= 0) {
+            CO_WAIT_UNTIL(&t->co, (t->err = step_begin(t->cell->sensors, cotes_renard[t->detecte],
+                                                       &t->alarme)) != WOULD_BLOCK,
+                          now_ns() + POLL_NS);
+            if (t->err != OK) {
+                fprintf(stderr, "[RENARD] Erreur %d de step_begin, arrêt de la patrouille\n", t->err);
+                break;
+            }
+            CO_WAIT_UNTIL(&t->co, step_done(&t->alarme), t->alarme.end_ns);
+            alarm_end(&t->alarme);
+            alarmes++;
+        } else {
+            liberer_remplacement(t->cell);
+        }
+        fin_de_scan(t->activation);
+    }
+    CO_END(&t->co);
+}
+
+int aigle(void *arg) {
+    aigle_t *t = arg;
+    CO_BEGIN(&t->co);
+    while (!should_stop) {
+        t->activation = activation(t->cell->sensors, ABOVE, periode_aigle);
+        CO_WAIT_UNTIL(&t->co, should_stop || now_ns() >= t->activation, t->activation);
+        if (should_stop) {
+            break;
+        }
+        CO_WAIT_UNTIL(&t->co, (t->err = step_begin(t->cell->sensors, ABOVE, &t->step)) != WOULD_BLOCK,
+                      now_ns() + POLL_NS);
+        if (t->err != OK) {
+            fprintf(stderr, "[AIGLE] Erreur %d de step_begin, arrêt de la patrouille\n", t->err);
+            break;
+        }
+        CO_WAIT_UNTIL(&t->co, step_done(&t->step), t->step.end_ns);
+        scans++;
+        if (sense_end(&t->step, NULL) == DETECTED) {
+            CO_WAIT_UNTIL(&t->co, (t->err = step_begin(t->cell->sensors, ABOVE, &t->alarme)) != WOULD_BLOCK,
+                          now_ns() + POLL_NS);
+            if (t->err != OK) {
+                fprintf(stderr, "[AIGLE] Erreur %d de step_begin, arrêt de la patrouille\n", t->err);
+                break;
+            }
+            CO_WAIT_UNTIL(&t->co, step_done(&t->alarme), t->alarme.end_ns);
+            alarm_end(&t->alarme);
+            alarmes++;
+        } else {
+            liberer_remplacement(t->cell);
+        }
+        fin_de_scan(t->activation);
+    }
+    CO_END(&t->co);
+}
+
+int remplacement(void *arg) {
+    remplacement_t *t = arg;
+    CO_BEGIN(&t->co);
+    while (1) {
+        CO_WAIT_UNTIL(&t->co, should_stop || t->cell->a_remplacer > 0, NEVER);
+        if (should_stop) {
+            break;
+        }
+        t->cell->a_remplacer--;
+        add_chicken(t->cell->coop);
+    }
+    CO_END(&t->co);
+}
+
+int main(int argc, char *argv[]) {
+    int nb = argc > 1 ? atoi(argv[1]) : 1000;
+    int secondes = argc > 2 ? atoi(argv[2]) : 20;
+    unsigned int facteur = argc > 3 ? atoi(argv[3]) : 1;
+    if (nb <= 0 || secondes <= 0 || facteur < 1 || facteur > EAGLE_TIME) {
+        fprintf(stderr, "Usage : %s [poulaillers] [secondes] [facteur]\n", argv[0]);
+        return 1;
+    }
+    periode_renard = FOX_TIME * 1000000ULL / facteur;
+    periode_aigle = EAGLE_TIME * 1000000ULL / facteur;
+    avance = 3 * STEP_TIME * 1000000ULL / facteur;
+    srand((unsigned)time(NULL));
+    signal(SIGINT, sigint_handler);
+
+    cell_t *cells = calloc(nb, sizeof(cell_t));
+    renard_t *renards = calloc(nb, sizeof(renard_t));
+    aigle_t *aigles = calloc(nb, sizeof(aigle_t));
+    remplacement_t *remplacements = calloc(nb, sizeof(remplacement_t));
+    tache_t *taches = calloc(3 * nb, sizeof(tache_t));
+    if (!cells || !renards || !aigles || !remplacements || !taches) {
+        fprintf(stderr, "Mémoire insuffisante\n");
+        return 1;
+    }
+
+    int prets;
+    for (prets = 0; prets < nb; ++prets) {
+        cell_t *cell = &cells[prets];
+        if (init_coop_arena(&cell->coop, &cell->sensors, 1, MAX_SENSOR_HEADS) != OK) {
+            fprintf(stderr, "Erreur lors de l'initialisation du poulailler %d\n", prets);
+            break;
+        }
+        set_coop_mode(cell->coop, COOP_QUIET | COOP_NO_EXIT);
+        set_time_scale(cell->sensors, facteur);
+        renards[prets].cell = aigles[prets].cell = remplacements[prets].cell = cell;
+        cell->remplacement = &remplacements[prets].co;
+        taches[3*prets] = (tache_t) { &renards[prets].co, renard, 0 };
+        taches[3*prets+1] = (tache_t) { &aigles[prets].co, aigle, 0 };
+        taches[3*prets+2] = (tache_t) { &remplacements[prets].co, remplacement, 0 };
+        start_hunt(cell->sensors, cell->coop);
+    }
+    int nb_taches = 3 * prets;
+    printf("%d poulaillers, %d coroutines sur un seul thread\n", prets, nb_taches);
+
+    // Planificateur : appelle chaque coroutine dont l'heure de réveil est passée,
+    // puis dort jusqu'au prochain réveil. Continue après l'arrêt jusqu'à ce que
+    // toutes les coroutines aient fini leur période (et libéré leurs têtes).
+    unsigned long long fin = now_ns() + secondes * 1000000000ULL;
+    int actives = nb_taches;
+    int arret_signale = 0;
+    while (actives > 0) {
+        unsigned long long now = now_ns();
+        if (!should_stop && now >= fin) {
+            should_stop = 1;
+        }
+        if (should_stop && !arret_signale) {
+            for (int i = 0; i < nb_taches; ++i) {
+                taches[i].co->wake_ns = 0;
+            }
+            arret_signale = 1;
+        }
+        unsigned long long prochain = now + MAX_IDLE_NS;
+        for (int i = 0; i < nb_taches; ++i) {
+            tache_t *t = &taches[i];
+            if (t->fini) {
+                continue;
+            }
+            if (t->co->wake_ns <= now && t->run(t->co) == CO_DONE) {
+                t->fini = 1;
+                actives--;
+                continue;
+            }
+            if (t->co->wake_ns < prochain) {
+                prochain = t->co->wake_ns;
+            }
+        }
+        if (prochain > now_ns()) {
+            struct timespec ts = { prochain / 1000000000ULL, prochain % 1000000000ULL };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+    }
+
+    unsigned long long vols = 0;
+    for (int i = 0; i < prets; ++i) {
+        unsigned long long stolen = 0;
+        get_stolen(cells[i].coop, &stolen);
+        vols += stolen;
+        stop_hunt(cells[i].sensors);
+        free_coop_arena(cells[i].coop);
+    }
+
+    pthread_attr_t attr;
+    size_t pile = 0;
+    pthread_attr_init(&attr);
+    pthread_attr_getstacksize(&attr, &pile);
+    pthread_attr_destroy(&attr);
+    size_t etat = sizeof(renard_t) + sizeof(aigle_t) + sizeof(remplacement_t) + 3 * sizeof(tache_t);
+    printf("Scans: %llu, alarmes: %llu, vols: %llu\n", scans, alarmes, vols);
+    printf("Échéances manquées: %llu (retard max %.2f ms)\n", echeances_manquees, retard_max / 1e6);
+    printf("Mémoire par poulailler : %zu octets d'état de coroutines (contre 3 piles de %zu Kio en threads)\n",
+           etat, pile / 1024);
+
+    free(cells);
+    free(renards);
+    free(aigles);
+    free(remplacements);
+    free(taches);
+    return 0;
+}
@@ -0,0 +1,134 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "chickens.h"
+#include "executor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+// Patrouilles de nombreux poulaillers sur un pool de threads à vol de travail :
+// chaque poulailler fournit deux tâches périodiques (renard et aigle) calées
+// sur la phase de leur menace, avec pour échéance l'attaque suivante. Le
+// rapport donne le retard de chaque tâche par rapport à cette échéance.
+//
+// Usage : patrol-executor [poulaillers] [workers] [secondes] [facteur] [-v]
+//   -v  affiche aussi une ligne par tâche
+
+volatile sig_atomic_t should_stop = 0;
+
+void sigint_handler(int signum) {
+    should_stop = 1;
+}
+
+typedef struct {
+    coop_t *coop;
+    sensors_t *sensors;
+} cell_t;
+
+const side_t cotes_renard[3] = {NORTH, SOUTH, EAST};
+
+void patrouille_renard(void *arg) {
+    cell_t *cell = arg;
+    sense_t resultats[3];
+    if (sense_multi(cell->sensors, cotes_renard, 3, resultats) != OK) {
+        return;
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (resultats[i] == DETECTED) {
+            sound_alarm(cell->sensors, cotes_renard[i]);
+            return;
+        }
+    }
+    add_chicken(cell->coop);
+}
+
+void patrouille_aigle(void *arg) {
+    cell_t *cell = arg;
+    error_t err;
+    if (sense(cell->sensors, ABOVE, &err) == DETECTED) {
+        sound_alarm(cell->sensors, ABOVE);
+    } else if (err == OK) {
+        add_chicken(cell->coop);
+    }
+}
+
+// Première libération : `avance` avant la prochaine attaque de la menace
+unsigned long long premiere_liberation(sensors_t *sensors, side_t side, unsigned long long avance,
+                                       unsigned long long periode) {
+    struct timespec expiry;
+    unsigned long long maintenant = now_ns();
+    get_next_expiry(sensors, side, &expiry);
+    unsigned long long cible = expiry.tv_sec * 1000000000ULL + expiry.tv_nsec;
+    while (cible < maintenant + avance) {
+        cible += periode;
+    }
+    return cible - avance;
+}
+
+int main(int argc, char *argv[]) {
+    int detail = argc > 1 && argv[argc-1][0] == '-' && argv[argc-1][1] == 'v';
+    int nargs = detail ? argc - 1 : argc;
+    int nb = nargs > 1 ? atoi(argv[1]) : 4;
+    int workers = nargs > 2 ? atoi(argv[2]) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int secondes = nargs > 3 ? atoi(argv[3]) : 20;
+    unsigned int facteur = nargs > 4 ? atoi(argv[4]) : 1;
+    if (nb <= 0 || workers <= 0 || secondes <= 0 || facteur < 1 || facteur > EAGLE_TIME) {
+        fprintf(stderr, "Usage : %s [poulaillers] [workers] [secondes] [facteur] [-v]\n", argv[0]);
+        return 1;
+    }
+    unsigned long long periode_renard = FOX_TIME * 1000000ULL / facteur;
+    unsigned long long periode_aigle = EAGLE_TIME * 1000000ULL / facteur;
+    // WCET de 2 pas + 1 pas de marge avant l'attaque
+    unsigned long long avance = 3 * STEP_TIME * 1000000ULL / facteur;
+    srand((unsigned)time(NULL));
+    signal(SIGINT, sigint_handler);
+
+    cell_t *cells = calloc(nb, sizeof(cell_t));
+    executor_t *ex;
+    if (!cells || executor_init(&ex, workers) != OK) {
+        fprintf(stderr, "Erreur lors de l'initialisation de l'exécuteur\n");
+        free(cells);
+        return 1;
+    }
+    int prets;
+    for (prets = 0; prets < nb; ++prets) {
+        cell_t *cell = &cells[prets];
+        if (init_coop_arena(&cell->coop, &cell->sensors, 1, MAX_SENSOR_HEADS) != OK) {
+            fprintf(stderr, "Erreur lors de l'initialisation du poulailler %d\n", prets);
+            break;
+        }
+        set_coop_mode(cell->coop, COOP_QUIET | COOP_NO_EXIT);
+        set_time_scale(cell->sensors, facteur);
+        start_hunt(cell->sensors, cell->coop);
+        executor_add(ex, "renard", patrouille_renard, cell,
+                     premiere_liberation(cell->sensors, NORTH, avance, periode_renard), periode_renard, avance);
+        executor_add(ex, "aigle", patrouille_aigle, cell,
+                     premiere_liberation(cell->sensors, ABOVE, avance, periode_aigle), periode_aigle, avance);
+    }
+    printf("%d poulaillers, %d tâches, %d workers\n", prets, 2 * prets, workers);
+
+    if (executor_start(ex) != OK) {
+        fprintf(stderr, "Erreur lors du démarrage de l'exécuteur\n");
+        should_stop = 1;
+    }
+    for (int s = 0; s < secondes && !should_stop; ++s) {
+        sleep(1);
+    }
+    executor_stop(ex);
+
+    unsigned long long vols = 0;
+    for (int i = 0; i < prets; ++i) {
+        unsigned long long stolen = 0;
+        get_stolen(cells[i].coop, &stolen);
+        vols += stolen;
+        stop_hunt(cells[i].sensors);
+        free_coop_arena(cells[i].coop);
+    }
+    executor_report(ex, stdout, detail);
+    printf("Vols: %llu\n", vols);
+    executor_free(ex);
+    free(cells);
+    return 0;
+}
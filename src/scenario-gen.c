@@ -0,0 +1,77 @@
+#include "scenario.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Générateur de scénarios de menaces (format de scenario.h) :
+//   aleatoire  le comportement habituel : renard toutes les FOX_TIME, aigle toutes
+//              les EAGLE_TIME, côté tiré au hasard (AWAY compris)
+//   rafale     pire cas de fréquence : les deux menaces changent de côté à chaque
+//              pas et ne sont jamais AWAY
+//   simultane  pire cas de phase : renard et aigle attaquent aux mêmes instants,
+//              toutes les EAGLE_TIME, toujours sur un côté actif
+//
+// Usage : scenario-gen fichier [aleatoire|rafale|simultane] [secondes] [graine]
+
+// Côté d'une menace : `actif` interdit AWAY
+side_t tirer_cote(int menace, int actif) {
+    if (menace == EAGLE_THREAT) {
+        return actif || rand() % 2 ? ABOVE : AWAY;
+    }
+    return actif ? NORTH + rand() % 3 : rand() % 4;
+}
+
+int main(int argc, char *argv[]) {
+    const char *mode = argc > 2 ? argv[2] : "aleatoire";
+    long secondes = argc > 3 ? atol(argv[3]) : 60;
+    unsigned int graine = argc > 4 ? (unsigned int) atol(argv[4]) : (unsigned int) time(NULL);
+    unsigned long long periode[NUM_THREATS];
+    int actif;
+    if (!strcmp(mode, "aleatoire")) {
+        periode[FOX_THREAT] = FOX_TIME;
+        periode[EAGLE_THREAT] = EAGLE_TIME;
+        actif = 0;
+    } else if (!strcmp(mode, "rafale")) {
+        periode[FOX_THREAT] = STEP_TIME;
+        periode[EAGLE_THREAT] = STEP_TIME;
+        actif = 1;
+    } else if (!strcmp(mode, "simultane")) {
+        periode[FOX_THREAT] = EAGLE_TIME;
+        periode[EAGLE_THREAT] = EAGLE_TIME;
+        actif = 1;
+    } else {
+        mode = NULL;
+    }
+    if (argc < 2 || !mode || secondes <= 0 || secondes * 1000ULL > UINT32_MAX) {
+        fprintf(stderr, "Usage : %s fichier [aleatoire|rafale|simultane] [secondes] [graine]\n", argv[0]);
+        return 1;
+    }
+    FILE *f = fopen(argv[1], "wb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    srand(graine);
+    // L'en-tête est réécrit à la fin avec le nombre d'événements
+    struct scenario_header entete = {SCENARIO_MAGIC, SCENARIO_VERSION, 0};
+    fwrite(&entete, sizeof(entete), 1, f);
+    // Toutes les périodes sont des multiples du pas : on avance pas par pas, dans l'ordre
+    for (unsigned long long t = STEP_TIME; t <= secondes * 1000ULL; t += STEP_TIME) {
+        for (int menace = 0; menace < NUM_THREATS; ++menace) {
+            if (t % periode[menace]) {
+                continue;
+            }
+            struct scenario_event ev = {(uint32_t) t, (uint8_t) menace, (uint8_t) tirer_cote(menace, actif), 0};
+            fwrite(&ev, sizeof(ev), 1, f);
+            entete.count++;
+        }
+    }
+    if (fseek(f, 0, SEEK_SET) || fwrite(&entete, sizeof(entete), 1, f) != 1 || fclose(f)) {
+        perror(argv[1]);
+        return 1;
+    }
+    printf("%s : %llu événements sur %ld s (mode %s, graine %u)\n", argv[1],
+           (unsigned long long) entete.count, secondes, mode, graine);
+    return 0;
+}
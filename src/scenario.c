@@ -0,0 +1,162 @@
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scenario.h"
+
+// Pages behind the cursors are given back to the kernel by chunks of this size
+#define SCENARIO_RELEASE_BYTES (1UL << 20)
+
+
+struct scenario {
+    pthread_mutex_t lock;
+    int fd;
+    unsigned char *base;
+    size_t size;
+    const struct scenario_event *events;
+    uint64_t count;
+    /// Index of the next event to look at, for each threat
+    uint64_t cursor[NUM_THREATS];
+    /// Bytes from base already given back with MADV_DONTNEED
+    size_t released;
+    size_t page;
+    unsigned long long played[NUM_THREATS];
+    unsigned long long skipped;
+};
+
+static int valid_side(int threat, side_t side) {
+    if (side == AWAY) {
+        return 1;
+    }
+    return threat == FOX_THREAT ? side >= NORTH && side <= EAST : side == ABOVE;
+}
+
+/*
+ * Gives back the pages that no cursor will read again. Called with the lock held.
+ */
+static void release_behind(struct scenario *sc) {
+    uint64_t low = sc->cursor[0];
+    for (int i = 1; i < NUM_THREATS; ++i) {
+        if (sc->cursor[i] < low) {
+            low = sc->cursor[i];
+        }
+    }
+    size_t offset = sizeof(struct scenario_header) + low * sizeof(struct scenario_event);
+    offset -= offset % sc->page;
+    if (offset >= sc->released + SCENARIO_RELEASE_BYTES) {
+        madvise(sc->base + sc->released, offset - sc->released, MADV_DONTNEED);
+        sc->released = offset;
+    }
+}
+
+error_t scenario_open(scenario_t **sc, const char *path) {
+    if (!sc || !path) {
+        return NULL_PTR;
+    }
+    *sc = NULL;
+    struct scenario *s = calloc(1, sizeof(struct scenario));
+    if (!s) {
+        return MALLOC;
+    }
+    error_t res = FILE_ERROR;
+    struct stat st;
+    s->fd = open(path, O_RDONLY);
+    if (s->fd < 0) {
+        goto open_error;
+    }
+    if (fstat(s->fd, &st) < 0 || st.st_size < (off_t) sizeof(struct scenario_header)) {
+        goto map_error;
+    }
+    s->size = st.st_size;
+    s->base = mmap(NULL, s->size, PROT_READ, MAP_PRIVATE, s->fd, 0);
+    if (s->base == MAP_FAILED) {
+        goto map_error;
+    }
+    const struct scenario_header *header = (const struct scenario_header *) s->base;
+    if (header->magic != SCENARIO_MAGIC || header->version != SCENARIO_VERSION
+        || header->count > (s->size - sizeof(struct scenario_header)) / sizeof(struct scenario_event)) {
+        goto format_error;
+    }
+    // Read ahead aggressively, pages are read once in order
+    madvise(s->base, s->size, MADV_SEQUENTIAL);
+    s->events = (const struct scenario_event *) (s->base + sizeof(struct scenario_header));
+    s->count = header->count;
+    s->page = sysconf(_SC_PAGESIZE);
+    if (pthread_mutex_init(&s->lock, NULL)) {
+        res = MUTEX;
+        goto format_error;
+    }
+    *sc = s;
+    return OK;
+
+format_error:
+    munmap(s->base, s->size);
+map_error:
+    close(s->fd);
+open_error:
+    free(s);
+    return res;
+}
+
+error_t scenario_close(scenario_t *sc) {
+    if (!sc) {
+        return NULL_PTR;
+    }
+    error_t res = OK;
+    if (pthread_mutex_destroy(&sc->lock)) {
+        res = MUTEX;
+    }
+    munmap(sc->base, sc->size);
+    close(sc->fd);
+    free(sc);
+    return res;
+}
+
+error_t scenario_play(scenario_t *sc, sensors_t *sensors) {
+    if (!sc || !sensors) {
+        return NULL_PTR;
+    }
+    return script_threats(sensors, scenario_next, sc);
+}
+
+int scenario_next(void *ctx, int threat, unsigned long long *at_ns, side_t *side) {
+    struct scenario *sc = ctx;
+    if (!sc || threat < 0 || threat >= NUM_THREATS || pthread_mutex_lock(&sc->lock)) {
+        return 0;
+    }
+    int found = 0;
+    uint64_t i = sc->cursor[threat];
+    while (i < sc->count && !found) {
+        const struct scenario_event *event = &sc->events[i++];
+        if (event->threat != threat) {
+            continue;
+        }
+        if (!valid_side(threat, event->side)) {
+            sc->skipped++;
+            continue;
+        }
+        *at_ns = event->time_ms * 1000000ULL;
+        *side = event->side;
+        sc->played[threat]++;
+        found = 1;
+    }
+    sc->cursor[threat] = i;
+    release_behind(sc);
+    pthread_mutex_unlock(&sc->lock);
+    return found;
+}
+
+void scenario_report(scenario_t *sc, FILE *out) {
+    if (!sc || !out || pthread_mutex_lock(&sc->lock)) {
+        return;
+    }
+    fprintf(out, "%llu events, played: fox %llu, eagle %llu, skipped %llu, released %.1f MiB of %.1f MiB\n",
+            (unsigned long long) sc->count, sc->played[FOX_THREAT], sc->played[EAGLE_THREAT],
+            sc->skipped, sc->released / 1048576.0, sc->size / 1048576.0);
+    pthread_mutex_unlock(&sc->lock);
+}
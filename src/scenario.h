@@ -0,0 +1,130 @@
+/**
+ * @file scenario.h
+ * @brief Scripted threat scenarios, replayed from memory-mapped binary files.
+ *
+ * A scenario file is a header followed by events sorted by time. Each event
+ * moves one threat to one side at a given time, stealing a chicken first if
+ * the threat was on an active side (see script_threats). The file is mapped,
+ * never read into memory: each threat walks it with its own cursor, and the
+ * pages behind both cursors are given back to the kernel as the replay goes,
+ * so scenarios much larger than the memory can be played.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "chickens.h"
+
+
+// --- Constants and Macros ---
+
+/**
+ * @def SCENARIO_MAGIC
+ * @brief Value of the magic field of a scenario file ("CHKS").
+ */
+#define SCENARIO_MAGIC 0x43484b53U
+
+/**
+ * @def SCENARIO_VERSION
+ * @brief Version of the file format. Bumped on every incompatible change.
+ */
+#define SCENARIO_VERSION 1U
+
+
+// --- Structures ---
+
+/**
+ * @struct scenario_header
+ * @brief Start of a scenario file (16 bytes), in the byte order of the host.
+ */
+struct scenario_header {
+    /// SCENARIO_MAGIC
+    uint32_t magic;
+    /// SCENARIO_VERSION
+    uint32_t version;
+    /// Number of events following the header
+    uint64_t count;
+};
+
+/**
+ * @struct scenario_event
+ * @brief One event of a scenario file (8 bytes).
+ *
+ * Events must be sorted by time; an event earlier than the previous one of
+ * its threat is played as soon as possible. Events with a side the threat
+ * cannot take are skipped, and events of unknown threats are ignored.
+ */
+struct scenario_event {
+    /// Time of the event, in ms since start_hunt
+    uint32_t time_ms;
+    /// The threat (enum threat_index)
+    uint8_t threat;
+    /// The side it moves to (side_t), AWAY included
+    uint8_t side;
+    /// Must be 0
+    uint16_t reserved;
+};
+
+_Static_assert(sizeof(struct scenario_header) == 16, "scenario_header must stay 16 bytes");
+_Static_assert(sizeof(struct scenario_event) == 8, "scenario_event must stay 8 bytes");
+
+/**
+ * @typedef scenario_t
+ * @brief A scenario being replayed (Opaque structure).
+ */
+typedef struct scenario scenario_t;
+
+
+// --- Functions ---
+
+/**
+ * @brief Maps a scenario file and checks its header.
+ *
+ * Must be closed with scenario_close, after stop_hunt.
+ *
+ * @param sc Pointer to a pointer of type scenario_t, which will be set.
+ * @param path Path of the file.
+ * @return error_t Returns FILE_ERROR if the file cannot be mapped or is not a valid scenario.
+ */
+error_t scenario_open(scenario_t **sc, const char *path);
+
+/**
+ * @brief Unmaps the scenario.
+ *
+ * @param sc Pointer to the scenario.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t scenario_close(scenario_t *sc);
+
+/**
+ * @brief Makes the threats of the sensors follow the scenario, from its start.
+ *
+ * Must be called before start_hunt. A scenario drives one sensors_t at a time.
+ *
+ * @param sc Pointer to the scenario.
+ * @param sensors Takes a pointer to a sensors_t.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t scenario_play(scenario_t *sc, sensors_t *sensors);
+
+/**
+ * @brief Gives the next event of a threat (a threat_script_fn).
+ *
+ * @param ctx Pointer to the scenario.
+ * @param threat Index of the threat (enum threat_index).
+ * @param at_ns Set to the time of the event, in ns since start_hunt.
+ * @param side Set to the side of the event.
+ * @return int 1 if an event was found, 0 at the end of the scenario.
+ */
+int scenario_next(void *ctx, int threat, unsigned long long *at_ns, side_t *side);
+
+/**
+ * @brief Prints the progress of the replay: events played and skipped, memory released.
+ *
+ * @param sc Pointer to the scenario.
+ * @param out Stream to print to.
+ */
+void scenario_report(scenario_t *sc, FILE *out);
@@ -0,0 +1,240 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "sensord.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// Banc d'essai du démon des capteurs : des clients connectés en parallèle
+// gardent chacun `profondeur` requêtes en vol (pipeline) pendant la durée
+// de la mesure, et mesurent le temps aller-retour de chaque requête. Une
+// ligne CSV : débit total et distribution des temps aller-retour.
+//
+// Usage : sensord-bench [-u chemin] [-c clients] [-p profondeur] [-b côtés] [-o ping|sense] [-d secondes]
+//   -u  socket du démon (SENSORD_PATH par défaut)
+//   -c  nombre de clients (une connexion et un thread chacun)
+//   -p  requêtes en vol par client (1 = sans pipeline)
+//   -b  côtés par requête de sense (1 à SENSORD_MAX_SIDES)
+//   -o  ping mesure le protocole seul, sense fait un pas de capteur par requête
+//   -d  durée de la mesure en secondes
+//
+// Avec sense, lancer le démon avec un grand facteur (ex. sensord chemin 2000)
+// pour que le pas ne masque pas le coût du protocole.
+
+typedef struct {
+    const char *chemin;
+    int profondeur;
+    int cotes;
+    int op;
+    unsigned long long fin_ns;
+    // Résultats
+    unsigned long long *rtt_ns;
+    size_t nb_rtt, cap_rtt;
+    unsigned long long erreurs;
+    int ok;
+} client_t;
+
+unsigned long long clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int ecrire_tout(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+void preparer(client_t *cl, struct sensord_request *req, uint32_t id) {
+    static const side_t cotes[SENSORD_MAX_SIDES] = {NORTH, SOUTH, EAST, ABOVE};
+    memset(req, 0, sizeof(*req));
+    req->id = id;
+    req->op = cl->op;
+    req->count = cl->cotes;
+    for (int i = 0; i < cl->cotes; ++i) {
+        req->sides[i] = cotes[i];
+    }
+}
+
+void* client(void *arg) {
+    client_t *cl = arg;
+    struct sockaddr_un adresse = {.sun_family = AF_UNIX};
+    strncpy(adresse.sun_path, cl->chemin, sizeof(adresse.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &adresse, sizeof(adresse)) < 0) {
+        perror("connect");
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+    int p = cl->profondeur;
+    unsigned long long *envoi_ns = calloc(p, sizeof(unsigned long long));
+    struct sensord_request *requetes = calloc(p, sizeof(struct sensord_request));
+    struct sensord_response *reponses = calloc(p, sizeof(struct sensord_response));
+    if (!envoi_ns || !requetes || !reponses) {
+        goto fin;
+    }
+    // Remplir le pipeline d'un coup
+    uint32_t prochain = 0;
+    unsigned long long maintenant = clock_ns();
+    for (int i = 0; i < p; ++i) {
+        preparer(cl, &requetes[i], prochain);
+        envoi_ns[prochain % p] = maintenant;
+        ++prochain;
+    }
+    if (ecrire_tout(fd, requetes, p * sizeof(struct sensord_request))) {
+        goto fin;
+    }
+    int en_vol = p;
+    size_t reste = 0;
+    while (en_vol) {
+        ssize_t n = read(fd, (char *) reponses + reste, p * sizeof(struct sensord_response) - reste);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            goto fin;
+        }
+        maintenant = clock_ns();
+        size_t total = reste + n;
+        int nb = total / sizeof(struct sensord_response);
+        int a_envoyer = 0;
+        for (int i = 0; i < nb; ++i) {
+            const struct sensord_response *rep = &reponses[i];
+            if (cl->nb_rtt == cl->cap_rtt) {
+                size_t cap = cl->cap_rtt ? 2 * cl->cap_rtt : 4096;
+                unsigned long long *tmp = realloc(cl->rtt_ns, cap * sizeof(unsigned long long));
+                if (!tmp) {
+                    goto fin;
+                }
+                cl->rtt_ns = tmp;
+                cl->cap_rtt = cap;
+            }
+            cl->rtt_ns[cl->nb_rtt++] = maintenant - envoi_ns[rep->id % p];
+            cl->erreurs += rep->status != OK;
+            --en_vol;
+            // Remplacer chaque réponse par une nouvelle requête tant que la mesure dure
+            if (maintenant < cl->fin_ns) {
+                preparer(cl, &requetes[a_envoyer++], prochain);
+                envoi_ns[prochain % p] = maintenant;
+                ++prochain;
+            }
+        }
+        reste = total - nb * sizeof(struct sensord_response);
+        memmove(reponses, (char *) reponses + nb * sizeof(struct sensord_response), reste);
+        if (a_envoyer) {
+            if (ecrire_tout(fd, requetes, a_envoyer * sizeof(struct sensord_request))) {
+                goto fin;
+            }
+            en_vol += a_envoyer;
+        }
+    }
+    cl->ok = 1;
+fin:
+    free(envoi_ns);
+    free(requetes);
+    free(reponses);
+    close(fd);
+    return NULL;
+}
+
+int comparer(const void *a, const void *b) {
+    unsigned long long x = *(const unsigned long long *) a;
+    unsigned long long y = *(const unsigned long long *) b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[]) {
+    const char *chemin = SENSORD_PATH;
+    int clients = 1, profondeur = 1, cotes = 1, secondes = 5;
+    int op = SENSORD_PING;
+    int opt;
+    while ((opt = getopt(argc, argv, "u:c:p:b:o:d:")) != -1) {
+        switch (opt) {
+            case 'u': chemin = optarg; break;
+            case 'c': clients = atoi(optarg); break;
+            case 'p': profondeur = atoi(optarg); break;
+            case 'b': cotes = atoi(optarg); break;
+            case 'o': op = strcmp(optarg, "sense") ? (strcmp(optarg, "ping") ? -1 : SENSORD_PING) : SENSORD_SENSE; break;
+            case 'd': secondes = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage : %s [-u chemin] [-c clients] [-p profondeur] [-b côtés] [-o ping|sense] [-d s]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (clients < 1 || profondeur < 1 || cotes < 1 || cotes > SENSORD_MAX_SIDES || secondes < 1 || op < 0) {
+        fprintf(stderr, "Paramètres invalides\n");
+        return 1;
+    }
+    client_t *cl = calloc(clients, sizeof(client_t));
+    pthread_t *threads = calloc(clients, sizeof(pthread_t));
+    if (!cl || !threads) {
+        fprintf(stderr, "Mémoire insuffisante\n");
+        return 1;
+    }
+    unsigned long long debut = clock_ns();
+    for (int i = 0; i < clients; ++i) {
+        cl[i] = (client_t) {.chemin = chemin, .profondeur = profondeur, .cotes = cotes, .op = op,
+                            .fin_ns = debut + secondes * 1000000000ULL};
+        if (pthread_create(&threads[i], NULL, client, &cl[i]) != 0) {
+            fprintf(stderr, "Erreur lors de la création du client %d\n", i);
+            clients = i;
+            break;
+        }
+    }
+    size_t total = 0;
+    unsigned long long erreurs = 0;
+    int echecs = 0;
+    for (int i = 0; i < clients; ++i) {
+        pthread_join(threads[i], NULL);
+        total += cl[i].nb_rtt;
+        erreurs += cl[i].erreurs;
+        echecs += !cl[i].ok;
+    }
+    double duree = (clock_ns() - debut) / 1e9;
+    unsigned long long *rtt = malloc((total ? total : 1) * sizeof(unsigned long long));
+    if (!rtt) {
+        fprintf(stderr, "Mémoire insuffisante\n");
+        return 1;
+    }
+    size_t k = 0;
+    double somme = 0;
+    for (int i = 0; i < clients; ++i) {
+        for (size_t j = 0; j < cl[i].nb_rtt; ++j) {
+            rtt[k++] = cl[i].rtt_ns[j];
+            somme += cl[i].rtt_ns[j];
+        }
+        free(cl[i].rtt_ns);
+    }
+    qsort(rtt, total, sizeof(unsigned long long), comparer);
+    printf("op,clients,depth,sides,requests,req_per_s,rtt_avg_us,rtt_p50_us,rtt_p99_us,rtt_max_us,errors\n");
+    printf("%s,%d,%d,%d,%zu,%.1f,%.2f,%.2f,%.2f,%.2f,%llu\n", op == SENSORD_SENSE ? "sense" : "ping",
+           clients, profondeur, cotes, total, total / duree, total ? somme / total / 1e3 : 0.0,
+           total ? rtt[total / 2] / 1e3 : 0.0, total ? rtt[total * 99 / 100] / 1e3 : 0.0,
+           total ? rtt[total - 1] / 1e3 : 0.0, erreurs);
+    if (echecs) {
+        fprintf(stderr, "%d client(s) en échec (démon absent ou connexion coupée)\n", echecs);
+    }
+    free(rtt);
+    free(cl);
+    free(threads);
+    return echecs ? 1 : 0;
+}
@@ -0,0 +1,276 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "chickens.h"
+#include "sensord.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Démon des capteurs : possède un poulailler et ses capteurs, et sert les
+// patrouilles clientes sur une socket Unix (protocole binaire de sensord.h).
+// Un thread par client ; chaque lecture récupère autant de requêtes que le
+// client en a envoyées (pipeline), et toutes leurs réponses partent en une
+// seule écriture.
+// SIGINT et SIGTERM sont bloqués dans tous les threads et attendus par un
+// thread dédié (sigwait), qui réveille la boucle d'accept par un tube : un
+// signal délivré à un thread client ou à un thread de timer arrête donc
+// aussi le démon.
+//
+// Usage : sensord [chemin] [facteur]
+
+// Requêtes lues (et réponses écrites) au plus par appel système
+#define LOT_MAX 256
+#define CLIENTS_MAX 1024
+
+volatile sig_atomic_t should_stop = 0;
+
+// Tube d'arrêt : écrit par le thread des signaux, surveillé par la boucle d'accept
+int tube_arret[2];
+
+void* attendre_signal(void *arg) {
+    sigset_t *signaux = arg;
+    int sig;
+    sigwait(signaux, &sig);
+    should_stop = 1;
+    if (write(tube_arret[1], "", 1) < 0) {
+        perror("write");
+    }
+    return NULL;
+}
+
+coop_t *coop;
+sensors_t *sensors;
+
+// Clients connectés, pour les réveiller et les attendre à l'arrêt
+pthread_mutex_t mutex_clients = PTHREAD_MUTEX_INITIALIZER;
+int fd_clients[CLIENTS_MAX];
+pthread_t thread_clients[CLIENTS_MAX];
+int actif_clients[CLIENTS_MAX];
+
+// Exécute une requête et remplit sa réponse.
+void traiter(const struct sensord_request *req, struct sensord_response *rep) {
+    memset(rep, 0, sizeof(*rep));
+    rep->id = req->id;
+    error_t res = OK;
+    side_t sides[SENSORD_MAX_SIDES];
+    if (req->op == SENSORD_SENSE || req->op == SENSORD_ALARM) {
+        if (req->count < 1 || req->count > SENSORD_MAX_SIDES) {
+            rep->status = INVALID_ARGUMENT;
+            return;
+        }
+        for (int i = 0; i < req->count; ++i) {
+            sides[i] = req->sides[i];
+        }
+    }
+    switch (req->op) {
+        case SENSORD_PING:
+            break;
+        case SENSORD_SENSE: {
+            // Tous les côtés de la requête en un seul pas
+            sense_t resultats[SENSORD_MAX_SIDES];
+            res = sense_multi(sensors, sides, req->count, resultats);
+            for (int i = 0; i < req->count; ++i) {
+                rep->results[i] = resultats[i];
+            }
+            rep->count = req->count;
+            break;
+        }
+        case SENSORD_ALARM:
+            for (int i = 0; i < req->count && res == OK; ++i) {
+                res = sound_alarm(sensors, sides[i]);
+            }
+            break;
+        case SENSORD_CHICKENS: {
+            int chickens;
+            res = get_chickens(coop, &chickens);
+            rep->value = chickens;
+            break;
+        }
+        default:
+            res = INVALID_ARGUMENT;
+    }
+    rep->status = res;
+}
+
+// Écrit tout le tampon, même en plusieurs fois.
+int ecrire_tout(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+void* servir_client(void *arg) {
+    int slot = (int) (long) arg;
+    int fd = fd_clients[slot];
+    struct sensord_request requetes[LOT_MAX];
+    struct sensord_response reponses[LOT_MAX];
+    // Octets d'une requête incomplète gardés pour la lecture suivante
+    size_t reste = 0;
+    while (!should_stop) {
+        ssize_t n = read(fd, (char *) requetes + reste, sizeof(requetes) - reste);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        size_t total = reste + n;
+        size_t nb = total / sizeof(struct sensord_request);
+        for (size_t i = 0; i < nb; ++i) {
+            traiter(&requetes[i], &reponses[i]);
+        }
+        if (nb && ecrire_tout(fd, reponses, nb * sizeof(struct sensord_response))) {
+            break;
+        }
+        reste = total - nb * sizeof(struct sensord_request);
+        memmove(requetes, (char *) requetes + nb * sizeof(struct sensord_request), reste);
+    }
+    close(fd);
+    pthread_mutex_lock(&mutex_clients);
+    fd_clients[slot] = -1;
+    pthread_mutex_unlock(&mutex_clients);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    const char *chemin = argc > 1 ? argv[1] : SENSORD_PATH;
+    unsigned int facteur = argc > 2 ? atoi(argv[2]) : 1;
+    struct sockaddr_un adresse = {.sun_family = AF_UNIX};
+    if (strlen(chemin) >= sizeof(adresse.sun_path) || facteur < 1 || facteur > EAGLE_TIME) {
+        fprintf(stderr, "Usage : %s [chemin] [facteur]\n", argv[0]);
+        return 1;
+    }
+    strcpy(adresse.sun_path, chemin);
+    srand((unsigned) time(NULL));
+
+    // Bloqués avant de créer le moindre thread : tous en héritent
+    sigset_t signaux;
+    sigemptyset(&signaux);
+    sigaddset(&signaux, SIGINT);
+    sigaddset(&signaux, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signaux, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    pthread_t thread_signaux;
+    if (pipe(tube_arret) < 0 || pthread_create(&thread_signaux, NULL, attendre_signal, &signaux)) {
+        fprintf(stderr, "Erreur lors de la mise en place de l'arrêt sur signal\n");
+        return 1;
+    }
+
+    if (init_coop(&coop) != OK) {
+        fprintf(stderr, "Erreur lors de l'initialisation du poulailler\n");
+        return 1;
+    }
+    // Le démon ne s'arrête pas quand il n'y a plus de poules
+    set_coop_mode(coop, COOP_QUIET | COOP_NO_EXIT);
+    if (init_sensors_heads(&sensors, MAX_SENSOR_HEADS) != OK) {
+        fprintf(stderr, "Erreur lors de l'initialisation des capteurs\n");
+        free_coop(coop);
+        return 1;
+    }
+    set_time_scale(sensors, facteur);
+
+    int ecoute = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(chemin);
+    if (ecoute < 0 || bind(ecoute, (struct sockaddr *) &adresse, sizeof(adresse)) < 0
+        || listen(ecoute, 128) < 0) {
+        perror("socket");
+        if (ecoute >= 0) {
+            close(ecoute);
+        }
+        free_sensors(sensors);
+        free_coop(coop);
+        return 1;
+    }
+    for (int i = 0; i < CLIENTS_MAX; ++i) {
+        fd_clients[i] = -1;
+    }
+    start_hunt(sensors, coop);
+    printf("[SENSORD] En écoute sur %s (facteur %u)\n", chemin, facteur);
+
+    while (!should_stop) {
+        struct pollfd attente[2] = {{ecoute, POLLIN, 0}, {tube_arret[0], POLLIN, 0}};
+        if (poll(attente, 2, -1) < 0) {
+            if (errno != EINTR) {
+                perror("poll");
+            }
+            continue;
+        }
+        if (attente[1].revents) {
+            break;
+        }
+        int fd = accept(ecoute, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EINTR) {
+                perror("accept");
+            }
+            continue;
+        }
+        pthread_mutex_lock(&mutex_clients);
+        int slot;
+        for (slot = 0; slot < CLIENTS_MAX && (actif_clients[slot] && fd_clients[slot] >= 0); ++slot) {
+        }
+        if (slot < CLIENTS_MAX && actif_clients[slot]) {
+            // Emplacement d'un client parti : récupérer son thread avant de le réutiliser
+            pthread_join(thread_clients[slot], NULL);
+            actif_clients[slot] = 0;
+        }
+        if (slot == CLIENTS_MAX) {
+            fprintf(stderr, "[SENSORD] Trop de clients, connexion refusée\n");
+            close(fd);
+        } else {
+            fd_clients[slot] = fd;
+            if (pthread_create(&thread_clients[slot], NULL, servir_client, (void *) (long) slot) == 0) {
+                actif_clients[slot] = 1;
+            } else {
+                fprintf(stderr, "[SENSORD] Erreur lors de la création du thread client\n");
+                fd_clients[slot] = -1;
+                close(fd);
+            }
+        }
+        pthread_mutex_unlock(&mutex_clients);
+    }
+
+    printf("\n[SENSORD] Arrêt en cours...\n");
+    close(ecoute);
+    unlink(chemin);
+    // Débloquer les clients en attente de lecture, puis les attendre
+    pthread_mutex_lock(&mutex_clients);
+    for (int i = 0; i < CLIENTS_MAX; ++i) {
+        if (actif_clients[i] && fd_clients[i] >= 0) {
+            shutdown(fd_clients[i], SHUT_RDWR);
+        }
+    }
+    pthread_mutex_unlock(&mutex_clients);
+    for (int i = 0; i < CLIENTS_MAX; ++i) {
+        if (actif_clients[i]) {
+            pthread_join(thread_clients[i], NULL);
+        }
+    }
+    stop_hunt(sensors);
+    unsigned long long stolen = 0;
+    get_stolen(coop, &stolen);
+    printf("[SENSORD] %llu poules volées pendant le service\n", stolen);
+    free_sensors(sensors);
+    free_coop(coop);
+    pthread_join(thread_signaux, NULL);
+    close(tube_arret[0]);
+    close(tube_arret[1]);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file sensord.h
+ * @brief Binary protocol of the sensor daemon, served over a Unix-domain socket.
+ *
+ * The daemon (sensord.c) owns a coop and its sensors, and serves patrol
+ * clients on a SOCK_STREAM Unix-domain socket. Clients send fixed-size
+ * requests and receive one fixed-size response per request, in the order of
+ * the requests. A request can carry several sides, sensed in a single step
+ * like sense_multi. Requests can be pipelined: a client may send many of them
+ * before reading the responses, and the daemon answers each batch it reads
+ * with a single write. All fields are in the byte order of the host, since
+ * both ends run on the same machine.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include "chickens.h"
+
+
+// --- Constants and Macros ---
+
+/**
+ * @def SENSORD_PATH
+ * @brief Default path of the socket of the daemon.
+ */
+#define SENSORD_PATH "/tmp/chickens-sensord.sock"
+
+/**
+ * @def SENSORD_MAX_SIDES
+ * @brief Maximum number of sides in one request.
+ */
+#define SENSORD_MAX_SIDES 4
+
+
+// --- Enumerations and Structures ---
+
+/**
+ * @enum sensord_op
+ * @brief Operation requested.
+ */
+enum sensord_op {
+    /// Does nothing, to measure the cost of the protocol itself
+    SENSORD_PING = 0,
+    /// Senses the sides of the request in one step (see sense_multi)
+    SENSORD_SENSE = 1,
+    /// Sounds the alarm on each side of the request, one after the other
+    SENSORD_ALARM = 2,
+    /// Gives the number of chickens in value
+    SENSORD_CHICKENS = 3,
+};
+
+/**
+ * @struct sensord_request
+ * @brief A request of a client (12 bytes).
+ */
+struct sensord_request {
+    /// Chosen by the client, copied into the response
+    uint32_t id;
+    /// The operation, see enum sensord_op
+    uint8_t op;
+    /// Number of sides used in sides (1 to SENSORD_MAX_SIDES for SENSE and ALARM)
+    uint8_t count;
+    /// The sides (side_t)
+    uint8_t sides[SENSORD_MAX_SIDES];
+    /// Must be 0
+    uint16_t reserved;
+};
+
+/**
+ * @struct sensord_response
+ * @brief The response to a request (16 bytes).
+ */
+struct sensord_response {
+    /// Identifier of the request
+    uint32_t id;
+    /// Result of the operation (error_t)
+    uint8_t status;
+    /// Number of results used in results
+    uint8_t count;
+    /// Result of the sense of each side of the request (sense_t)
+    uint8_t results[SENSORD_MAX_SIDES];
+    /// Always 0
+    uint16_t reserved;
+    /// Value returned by the operation (the chickens for SENSORD_CHICKENS)
+    int32_t value;
+};
+
+_Static_assert(sizeof(struct sensord_request) == 12, "sensord_request must stay 12 bytes");
+_Static_assert(sizeof(struct sensord_response) == 16, "sensord_response must stay 16 bytes");
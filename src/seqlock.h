@@ -0,0 +1,96 @@
+/**
+ * @file seqlock.h
+ * @brief Minimal sequence lock usable in process-local and shared memory.
+ *
+ * Writers serialize on a small spinlock and make the sequence number odd
+ * while they update the protected data. Readers never block writers: they
+ * copy the data and retry if the sequence number was odd or changed
+ * meanwhile. Only GCC atomic builtins on plain integers are used, so a
+ * seqlock_t can live in a shared-memory segment.
+ */
+
+
+#pragma once
+
+#include <sched.h>
+
+
+/**
+ * @struct seqlock
+ * @brief Sequence number and writer lock.
+ */
+typedef struct seqlock {
+    /// Even when the data is stable, odd while a writer is updating it
+    unsigned int seq;
+    /// Spinlock serializing the writers
+    unsigned int writer;
+} seqlock_t;
+
+/**
+ * @brief Starts a write section. Writers must keep it short.
+ *
+ * @param lock Pointer to the seqlock.
+ */
+static inline void seqlock_write_begin(seqlock_t *lock) {
+    while (__atomic_exchange_n(&lock->writer, 1, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Ends a write section started with seqlock_write_begin.
+ *
+ * @param lock Pointer to the seqlock.
+ */
+static inline void seqlock_write_end(seqlock_t *lock) {
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&lock->writer, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Starts a write section without taking the spinlock.
+ *
+ * For writers already serialized by a lock of their own (e.g., a mutex with
+ * priority inheritance), which must not mix with seqlock_write_begin on the
+ * same seqlock.
+ *
+ * @param lock Pointer to the seqlock.
+ */
+static inline void seqlock_update_begin(seqlock_t *lock) {
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Ends a write section started with seqlock_update_begin.
+ *
+ * @param lock Pointer to the seqlock.
+ */
+static inline void seqlock_update_end(seqlock_t *lock) {
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Starts a read section.
+ *
+ * @param lock Pointer to the seqlock.
+ * @return unsigned int The sequence number to give to seqlock_read_retry,
+ * odd if a writer is currently in its write section.
+ */
+static inline unsigned int seqlock_read_begin(const seqlock_t *lock) {
+    return __atomic_load_n(&lock->seq, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Tells whether the data copied since seqlock_read_begin may be torn.
+ *
+ * @param lock Pointer to the seqlock.
+ * @param seq Value returned by seqlock_read_begin.
+ * @return int Non-zero if the copy must be discarded and done again.
+ */
+static inline int seqlock_read_retry(const seqlock_t *lock, unsigned int seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (seq & 1) || __atomic_load_n(&lock->seq, __ATOMIC_RELAXED) != seq;
+}
@@ -0,0 +1,146 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "task_stats.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+
+
+error_t task_stats_init(task_stats_t *stats, const char *name, unsigned long long deadline_ms) {
+    if (!stats || !name) {
+        return NULL_PTR;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->name = name;
+    stats->deadline_ns = deadline_ms * 1000000ULL;
+    stats->response_min_ns = ~0ULL;
+    for (int i = 0; i < TASK_COUNTERS; ++i) {
+        stats->counter_fd[i] = -1;
+    }
+    return OK;
+}
+
+int task_stats_attach(task_stats_t *stats) {
+    int opened = 0;
+#ifdef __linux__
+    static const struct { unsigned int type; unsigned long long config; } events[TASK_COUNTERS] = {
+        [TASK_CONTEXT_SWITCHES] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+        [TASK_CPU_MIGRATIONS] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS },
+        [TASK_PAGE_FAULTS] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+        [TASK_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    };
+    for (int i = 0; i < TASK_COUNTERS; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        // Software events are counted by the kernel itself, only cycles are restricted to user mode
+        attr.exclude_kernel = events[i].type == PERF_TYPE_HARDWARE;
+        attr.exclude_hv = 1;
+        // pid 0 and cpu -1: the calling thread, on any CPU
+        stats->counter_fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (stats->counter_fd[i] >= 0) {
+            opened++;
+        }
+    }
+#endif
+    return opened;
+}
+
+int read_counter(int fd, unsigned long long *value) {
+    return fd >= 0 && read(fd, value, sizeof(*value)) == sizeof(*value);
+}
+
+void task_stats_begin(task_stats_t *stats, const struct timespec *release) {
+    unsigned long long now = now_ns();
+    stats->release_ns = release ? release->tv_sec * 1000000000ULL + release->tv_nsec : now;
+    unsigned long long late = now > stats->release_ns ? now - stats->release_ns : 0;
+    if (late > stats->start_late_max_ns) {
+        stats->start_late_max_ns = late;
+    }
+    stats->start_late_sum_ns += late;
+
+    int sampled = 0;
+    for (int i = 0; i < TASK_COUNTERS; ++i) {
+        unsigned long long value;
+        if (!read_counter(stats->counter_fd[i], &value)) {
+            continue;
+        }
+        // The first sample only sets the reference
+        if (stats->periods) {
+            unsigned long long delta = value - stats->counter_last[i];
+            stats->counter_sum[i] += delta;
+            if (delta > stats->counter_max[i]) {
+                stats->counter_max[i] = delta;
+            }
+            sampled = 1;
+        }
+        stats->counter_last[i] = value;
+    }
+    stats->sampled += sampled;
+}
+
+int task_stats_end(task_stats_t *stats) {
+    unsigned long long now = now_ns();
+    unsigned long long response = now > stats->release_ns ? now - stats->release_ns : 0;
+    stats->periods++;
+    stats->response_sum_ns += response;
+    if (response < stats->response_min_ns) {
+        stats->response_min_ns = response;
+    }
+    if (response > stats->response_max_ns) {
+        stats->response_max_ns = response;
+    }
+    if (!stats->deadline_ns) {
+        stats->last_lateness_ns = 0;
+        return 0;
+    }
+    stats->last_lateness_ns = (long long) response - (long long) stats->deadline_ns;
+    if (stats->last_lateness_ns > 0) {
+        stats->misses++;
+        return 1;
+    }
+    return 0;
+}
+
+void task_stats_report(FILE *out, task_stats_t *const *stats, int count) {
+    static const char *counter_names[TASK_COUNTERS] = {
+        "ctx-switches", "cpu-migrations", "page-faults", "cycles"
+    };
+    fprintf(out, "%-14s %8s %7s %12s %12s %12s %12s\n", "task", "periods", "misses",
+            "resp min ms", "resp avg ms", "resp max ms", "late max ms");
+    for (int t = 0; t < count; ++t) {
+        const task_stats_t *s = stats[t];
+        unsigned long long n = s->periods ? s->periods : 1;
+        fprintf(out, "%-14s %8llu %7llu %12.2f %12.2f %12.2f %12.2f\n", s->name, s->periods, s->misses,
+                s->periods ? s->response_min_ns / 1e6 : 0.0, s->response_sum_ns / 1e6 / n,
+                s->response_max_ns / 1e6, s->start_late_max_ns / 1e6);
+    }
+    fprintf(out, "%-14s %-15s %14s %14s\n", "task", "counter", "avg/period", "max/period");
+    for (int t = 0; t < count; ++t) {
+        const task_stats_t *s = stats[t];
+        for (int i = 0; i < TASK_COUNTERS; ++i) {
+            if (s->counter_fd[i] < 0 || !s->sampled) {
+                fprintf(out, "%-14s %-15s %14s %14s\n", s->name, counter_names[i], "n/a", "n/a");
+            } else {
+                fprintf(out, "%-14s %-15s %14.1f %14llu\n", s->name, counter_names[i],
+                        (double) s->counter_sum[i] / s->sampled, s->counter_max[i]);
+            }
+        }
+    }
+}
+
+void task_stats_close(task_stats_t *stats) {
+    for (int i = 0; i < TASK_COUNTERS; ++i) {
+        if (stats->counter_fd[i] >= 0) {
+            close(stats->counter_fd[i]);
+            stats->counter_fd[i] = -1;
+        }
+    }
+}
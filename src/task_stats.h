@@ -0,0 +1,135 @@
+/**
+ * @file task_stats.h
+ * @brief Per-task timing statistics and OS counters for the patrol tasks.
+ *
+ * Each periodic task records, for every period, its release lateness and its
+ * response time against its deadline. When the task attaches to the OS
+ * counters, the context switches, CPU migrations, page faults and CPU cycles
+ * of its thread are sampled once per period with perf_event_open, and all of
+ * it is printed in a single report.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+
+#include "chickens.h"
+
+
+// --- Enumerations and Structures ---
+
+/**
+ * @enum task_counter
+ * @brief OS counters sampled for each task.
+ */
+enum task_counter {
+    /// Context switches of the thread (software counter)
+    TASK_CONTEXT_SWITCHES = 0,
+    /// Migrations of the thread to another CPU (software counter)
+    TASK_CPU_MIGRATIONS = 1,
+    /// Page faults of the thread (software counter)
+    TASK_PAGE_FAULTS = 2,
+    /// CPU cycles in user mode (hardware counter, often missing in VMs)
+    TASK_CYCLES = 3,
+    /// Number of counters
+    TASK_COUNTERS = 4,
+};
+
+/**
+ * @struct task_stats
+ * @brief Statistics of one task. All times are in ns.
+ */
+struct task_stats {
+    /// Name of the task in the report
+    const char *name;
+    /// Relative deadline, 0 if the task has none
+    unsigned long long deadline_ns;
+    /// Release time of the current period (CLOCK_MONOTONIC)
+    unsigned long long release_ns;
+    /// Number of completed periods
+    unsigned long long periods;
+    /// Number of periods completed after their deadline
+    unsigned long long misses;
+    /// Lateness of the last period (completion - deadline, negative if on time)
+    long long last_lateness_ns;
+    /// Shortest, longest and total response time (completion - release)
+    unsigned long long response_min_ns, response_max_ns, response_sum_ns;
+    /// Longest and total release lateness (start - release)
+    unsigned long long start_late_max_ns, start_late_sum_ns;
+    /// File descriptor of each counter, -1 if unavailable
+    int counter_fd[TASK_COUNTERS];
+    /// Value of each counter at the start of the current period
+    unsigned long long counter_last[TASK_COUNTERS];
+    /// Number of periods in which the counters were sampled
+    unsigned long long sampled;
+    /// Total and largest per-period increase of each counter
+    unsigned long long counter_sum[TASK_COUNTERS], counter_max[TASK_COUNTERS];
+};
+
+/**
+ * @typedef task_stats_t
+ * @brief Typedef for the statistics of a task.
+ * @see struct task_stats
+ */
+typedef struct task_stats task_stats_t;
+
+
+// --- Functions ---
+
+/**
+ * @brief Initializes the statistics of a task, without OS counters.
+ *
+ * @param stats Pointer to the statistics to initialize.
+ * @param name Name of the task (e.g., "RENARD"), must outlive the statistics.
+ * @param deadline_ms Relative deadline of each period (ms), 0 if none.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t task_stats_init(task_stats_t *stats, const char *name, unsigned long long deadline_ms);
+
+/**
+ * @brief Opens the OS counters of the calling thread.
+ *
+ * Must be called from the thread running the task. Counters that the kernel
+ * refuses (no perf_event support, perf_event_paranoid, no PMU in a VM, ...)
+ * are reported as unavailable; the timing statistics work either way.
+ *
+ * @param stats Pointer to the statistics of the task.
+ * @return int Number of counters actually opened.
+ */
+int task_stats_attach(task_stats_t *stats);
+
+/**
+ * @brief Marks the start of a period.
+ *
+ * Samples the counters, which therefore cover whole periods, sleep included.
+ *
+ * @param stats Pointer to the statistics of the task.
+ * @param release CLOCK_MONOTONIC release time of the period, NULL for now.
+ */
+void task_stats_begin(task_stats_t *stats, const struct timespec *release);
+
+/**
+ * @brief Marks the completion of the current period.
+ *
+ * @param stats Pointer to the statistics of the task.
+ * @return int Non-zero if the period missed its deadline.
+ */
+int task_stats_end(task_stats_t *stats);
+
+/**
+ * @brief Prints the timing statistics and counters of several tasks.
+ *
+ * @param out Stream to print to.
+ * @param stats Array of pointers to the statistics of the tasks.
+ * @param count Number of tasks.
+ */
+void task_stats_report(FILE *out, task_stats_t *const *stats, int count);
+
+/**
+ * @brief Closes the OS counters of a task.
+ *
+ * @param stats Pointer to the statistics of the task.
+ */
+void task_stats_close(task_stats_t *stats);
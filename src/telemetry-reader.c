@@ -0,0 +1,64 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+
+// Lecteur de télémétrie : affiche périodiquement un instantané cohérent du
+// segment publié par la simulation, sans jamais prendre ses mutex.
+//
+// Usage : telemetry-reader [nom_du_segment] [période_ms]
+
+volatile sig_atomic_t should_stop = 0;
+
+void sigint_handler(int signum) {
+    should_stop = 1;
+}
+
+const char* side_name(int side) {
+    static const char *names[TELEMETRY_SIDES] = {"AWAY", "NORTH", "SOUTH", "EAST", "ABOVE"};
+    return side >= 0 && side < TELEMETRY_SIDES ? names[side] : "UNKNOWN";
+}
+
+int main(int argc, char *argv[]) {
+    const char *name = argc > 1 ? argv[1] : TELEMETRY_NAME;
+    long period_ms = argc > 2 ? atol(argv[2]) : 1000;
+    if (period_ms <= 0) {
+        fprintf(stderr, "Période invalide : %s\n", argv[2]);
+        return 1;
+    }
+
+    const struct telemetry *segment;
+    if (telemetry_attach(name, &segment) != OK) {
+        fprintf(stderr, "Impossible d'ouvrir le segment %s (simulation lancée ?)\n", name);
+        return 1;
+    }
+    signal(SIGINT, sigint_handler);
+
+    struct timespec period = { period_ms / 1000, (period_ms % 1000) * 1000000 };
+    struct telemetry_data data;
+    while (!should_stop) {
+        if (telemetry_read(segment, &data) != OK) {
+            fprintf(stderr, "Instantané incohérent (écrivain bloqué ?)\n");
+        } else {
+            printf("[%llu] poules=%d renard=%s aigle=%s dernier_pas=%.1fms\n",
+                   (unsigned long long) data.updates, data.chickens,
+                   side_name(data.threat_side[FOX_THREAT]),
+                   side_name(data.threat_side[EAGLE_THREAT]),
+                   data.last_step_ns / 1e6);
+            for (int side = NORTH; side <= ABOVE; ++side) {
+                printf("    %-6s detect=%llu alarm=%llu vol=%llu\n", side_name(side),
+                       (unsigned long long) data.detects[side],
+                       (unsigned long long) data.alarms[side],
+                       (unsigned long long) data.steals[side]);
+            }
+            fflush(stdout);
+        }
+        nanosleep(&period, NULL);
+    }
+
+    telemetry_detach(segment);
+    return 0;
+}
@@ -0,0 +1,204 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "telemetry.h"
+
+#define TELEMETRY_READ_TRIES 100000
+
+
+static struct telemetry *telemetry = NULL;
+static char telemetry_name[256];
+/// Serializes the writers; created with init_mutex, so it follows the protocol of the system mutexes
+static pthread_mutex_t telemetry_mutex;
+
+error_t telemetry_open(const char *name) {
+    if (!name) {
+        return NULL_PTR;
+    }
+    if (telemetry || strlen(name) >= sizeof(telemetry_name)) {
+        return SHM;
+    }
+    if (init_mutex(&telemetry_mutex, NULL) != OK) {
+        return MUTEX;
+    }
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        pthread_mutex_destroy(&telemetry_mutex);
+        return SHM;
+    }
+    if (ftruncate(fd, sizeof(struct telemetry))) {
+        close(fd);
+        shm_unlink(name);
+        pthread_mutex_destroy(&telemetry_mutex);
+        return SHM;
+    }
+    struct telemetry *segment = mmap(NULL, sizeof(struct telemetry), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        shm_unlink(name);
+        pthread_mutex_destroy(&telemetry_mutex);
+        return SHM;
+    }
+    memset(segment, 0, sizeof(struct telemetry));
+    segment->version = TELEMETRY_VERSION;
+    __atomic_store_n(&segment->magic, TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+    strcpy(telemetry_name, name);
+    __atomic_store_n(&telemetry, segment, __ATOMIC_RELEASE);
+    return OK;
+}
+
+error_t telemetry_close(void) {
+    struct telemetry *segment = __atomic_exchange_n(&telemetry, NULL, __ATOMIC_ACQ_REL);
+    if (!segment) {
+        return NULL_PTR;
+    }
+    // Lets a writer already in its section finish before the segment goes away
+    pthread_mutex_lock(&telemetry_mutex);
+    pthread_mutex_unlock(&telemetry_mutex);
+    pthread_mutex_destroy(&telemetry_mutex);
+    error_t res = OK;
+    if (munmap(segment, sizeof(struct telemetry))) {
+        res = SHM;
+    }
+    if (shm_unlink(telemetry_name)) {
+        res = SHM;
+    }
+    return res;
+}
+
+/*
+ * Every hook opens a write section on the segment, if any. Out-of-range sides
+ * are ignored rather than reported: telemetry must never make an action fail.
+ * Hooks run with head and coop mutexes held, so the writers are serialized by
+ * a mutex of the system protocol rather than the spinlock of the seqlock: a
+ * boosted thread spinning there could starve the writer it waits for.
+ */
+struct telemetry *telemetry_begin(void) {
+    struct telemetry *segment = __atomic_load_n(&telemetry, __ATOMIC_ACQUIRE);
+    if (segment) {
+        pthread_mutex_lock(&telemetry_mutex);
+        seqlock_update_begin(&segment->lock);
+    }
+    return segment;
+}
+
+void telemetry_end(struct telemetry *segment) {
+    segment->data.updates++;
+    seqlock_update_end(&segment->lock);
+    pthread_mutex_unlock(&telemetry_mutex);
+}
+
+void telemetry_chickens(int chickens) {
+    struct telemetry *segment = telemetry_begin();
+    if (segment) {
+        segment->data.chickens = chickens;
+        telemetry_end(segment);
+    }
+}
+
+void telemetry_side(int threat, side_t side) {
+    if (threat < 0 || threat >= NUM_THREATS) {
+        return;
+    }
+    struct telemetry *segment = telemetry_begin();
+    if (segment) {
+        segment->data.threat_side[threat] = side;
+        telemetry_end(segment);
+    }
+}
+
+void telemetry_detect(side_t side) {
+    if (side < AWAY || side >= TELEMETRY_SIDES) {
+        return;
+    }
+    struct telemetry *segment = telemetry_begin();
+    if (segment) {
+        segment->data.detects[side]++;
+        telemetry_end(segment);
+    }
+}
+
+void telemetry_alarm(side_t side) {
+    if (side < AWAY || side >= TELEMETRY_SIDES) {
+        return;
+    }
+    struct telemetry *segment = telemetry_begin();
+    if (segment) {
+        segment->data.alarms[side]++;
+        telemetry_end(segment);
+    }
+}
+
+void telemetry_steal(side_t side) {
+    if (side < AWAY || side >= TELEMETRY_SIDES) {
+        return;
+    }
+    struct telemetry *segment = telemetry_begin();
+    if (segment) {
+        segment->data.steals[side]++;
+        telemetry_end(segment);
+    }
+}
+
+void telemetry_step(uint64_t step_ns, uint64_t end_ns) {
+    struct telemetry *segment = telemetry_begin();
+    if (segment) {
+        segment->data.last_step_ns = step_ns;
+        segment->data.last_step_end_ns = end_ns;
+        telemetry_end(segment);
+    }
+}
+
+error_t telemetry_attach(const char *name, const struct telemetry **segment) {
+    if (!name || !segment) {
+        return NULL_PTR;
+    }
+    *segment = NULL;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return SHM;
+    }
+    const struct telemetry *mapped = mmap(NULL, sizeof(struct telemetry), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return SHM;
+    }
+    if (__atomic_load_n(&mapped->magic, __ATOMIC_ACQUIRE) != TELEMETRY_MAGIC
+        || mapped->version != TELEMETRY_VERSION) {
+        munmap((void *) mapped, sizeof(struct telemetry));
+        return SHM;
+    }
+    *segment = mapped;
+    return OK;
+}
+
+error_t telemetry_detach(const struct telemetry *segment) {
+    if (!segment) {
+        return NULL_PTR;
+    }
+    if (munmap((void *) segment, sizeof(struct telemetry))) {
+        return SHM;
+    }
+    return OK;
+}
+
+error_t telemetry_read(const struct telemetry *segment, struct telemetry_data *data) {
+    if (!segment || !data) {
+        return NULL_PTR;
+    }
+    for (int tries = 0; tries < TELEMETRY_READ_TRIES; ++tries) {
+        unsigned int seq = seqlock_read_begin(&segment->lock);
+        memcpy(data, (const void *) &segment->data, sizeof(*data));
+        if (!seqlock_read_retry(&segment->lock, seq)) {
+            return OK;
+        }
+        sched_yield();
+    }
+    return SHM;
+}
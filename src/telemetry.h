@@ -0,0 +1,189 @@
+/**
+ * @file telemetry.h
+ * @brief Live telemetry published in a named POSIX shared-memory segment.
+ *
+ * The simulation writes the chicken count, the side of each threat, per-side
+ * counters and the timing of the last step into the segment. External tools
+ * map it read-only and take consistent snapshots through the embedded
+ * seqlock, without ever touching the mutexes of the simulation.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include "chickens.h"
+#include "seqlock.h"
+
+
+// --- Constants and Macros ---
+
+/**
+ * @def TELEMETRY_NAME
+ * @brief Default name of the shared-memory segment.
+ */
+#define TELEMETRY_NAME "/chickens-telemetry"
+
+/**
+ * @def TELEMETRY_MAGIC
+ * @brief Value of the magic field of a valid segment ("CHKT").
+ */
+#define TELEMETRY_MAGIC 0x43484b54U
+
+/**
+ * @def TELEMETRY_VERSION
+ * @brief Version of the segment layout. Bumped on every incompatible change.
+ */
+#define TELEMETRY_VERSION 1U
+
+/**
+ * @def TELEMETRY_SIDES
+ * @brief Number of entries of the per-side arrays, indexed by side_t (AWAY to ABOVE).
+ */
+#define TELEMETRY_SIDES 5
+
+
+// --- Structures ---
+
+/**
+ * @struct telemetry_data
+ * @brief Published state. Only fixed-width fields, so the layout does not
+ * depend on the compiler of the reader.
+ */
+struct telemetry_data {
+    /// Number of chickens in the coop
+    int32_t chickens;
+    /// Current side of each threat, indexed by enum threat_index
+    uint8_t threat_side[NUM_THREATS];
+    /// Number of sense calls that detected a threat on each side
+    uint64_t detects[TELEMETRY_SIDES];
+    /// Number of alarms sounded on each side
+    uint64_t alarms[TELEMETRY_SIDES];
+    /// Number of chickens stolen from each side
+    uint64_t steals[TELEMETRY_SIDES];
+    /// Measured duration of the last sensor step (ns)
+    uint64_t last_step_ns;
+    /// CLOCK_MONOTONIC time at which the last sensor step ended (ns)
+    uint64_t last_step_end_ns;
+    /// Number of updates published so far
+    uint64_t updates;
+};
+
+/**
+ * @struct telemetry
+ * @brief Layout of the whole shared-memory segment.
+ */
+struct telemetry {
+    /// TELEMETRY_MAGIC once the segment is initialized
+    uint32_t magic;
+    /// TELEMETRY_VERSION of the writer
+    uint32_t version;
+    /// Protects data
+    seqlock_t lock;
+    /// The published state
+    struct telemetry_data data;
+};
+
+
+// --- Writer Functions ---
+
+/**
+ * @brief Creates the segment and starts publishing into it.
+ *
+ * Until this function is called, the publishing hooks do nothing. The segment
+ * reflects the state of the process, so it is meant for a single coop. The
+ * hooks serialize on a mutex created here with init_mutex: call
+ * set_lock_protocol first.
+ *
+ * @param name Name of the segment (e.g., TELEMETRY_NAME).
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t telemetry_open(const char *name);
+
+/**
+ * @brief Stops publishing, unmaps and removes the segment.
+ *
+ * Must be called once no hook can run any more (e.g., after stop_hunt).
+ *
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t telemetry_close(void);
+
+/**
+ * @brief Publishes the number of chickens.
+ *
+ * @param chickens Number of chickens in the coop.
+ */
+void telemetry_chickens(int chickens);
+
+/**
+ * @brief Publishes the side of a threat.
+ *
+ * @param threat Index of the threat (enum threat_index).
+ * @param side New side of the threat.
+ */
+void telemetry_side(int threat, side_t side);
+
+/**
+ * @brief Counts a detection on the given side.
+ *
+ * @param side Side on which a threat was detected.
+ */
+void telemetry_detect(side_t side);
+
+/**
+ * @brief Counts an alarm on the given side.
+ *
+ * @param side Side on which the alarm was sounded.
+ */
+void telemetry_alarm(side_t side);
+
+/**
+ * @brief Counts a chicken stolen from the given side.
+ *
+ * @param side Side from which the chicken was stolen.
+ */
+void telemetry_steal(side_t side);
+
+/**
+ * @brief Publishes the timing of the last sensor step.
+ *
+ * @param step_ns Duration of one step (ns).
+ * @param end_ns CLOCK_MONOTONIC time at which the step ended (ns).
+ */
+void telemetry_step(uint64_t step_ns, uint64_t end_ns);
+
+
+// --- Reader Functions ---
+
+/**
+ * @brief Maps an existing segment read-only.
+ *
+ * The segment must be released with telemetry_detach.
+ *
+ * @param name Name of the segment.
+ * @param segment Pointer to a pointer which will be set to the mapped segment.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t telemetry_attach(const char *name, const struct telemetry **segment);
+
+/**
+ * @brief Unmaps a segment mapped with telemetry_attach.
+ *
+ * @param segment The mapped segment.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t telemetry_detach(const struct telemetry *segment);
+
+/**
+ * @brief Copies a consistent snapshot of the published state.
+ *
+ * Never blocks the writers. Gives up with SHM if the writer seems stuck in
+ * its write section (e.g., it was killed while writing).
+ *
+ * @param segment The mapped segment.
+ * @param data Pointer to the structure which will receive the snapshot.
+ * @return error_t Returns an error_t (OK or error code).
+ */
+error_t telemetry_read(const struct telemetry *segment, struct telemetry_data *data);